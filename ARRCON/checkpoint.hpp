@@ -0,0 +1,139 @@
+/**
+ * @file	checkpoint.hpp
+ * @author	radj307
+ * @brief	Contains the Checkpoint object, which records script progress so that interrupted runs can be resumed.
+ *\n
+ *\n		Checkpoint files are plain text. The first line identifies the script:
+ *\n		  ARRCON-CHECKPOINT <command count> <script hash>
+ *\n		Each following line contains the index of the next command to execute.
+ *\n		Lines are appended in batches & synced to disk, so a crash loses at most one batch of progress.
+ */
+#pragma once
+#include <sysarch.h>
+#include <make_exception.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @class	Checkpoint
+ * @brief	Appends script progress to a checkpoint file.
+ */
+class Checkpoint {
+	int fd{ -1 };
+	size_t completed{ 0ull };
+	size_t synced{ 0ull };
+	std::chrono::steady_clock::time_point last_sync{ std::chrono::steady_clock::now() };
+
+	/// @brief	Number of completed commands to batch before syncing.
+	static constexpr const size_t BATCH_SIZE{ 64ull };
+	/// @brief	Maximum amount of time to hold unsynced progress.
+	static constexpr const std::chrono::milliseconds BATCH_TIME{ 1000 };
+
+	static constexpr const auto HEADER{ "ARRCON-CHECKPOINT" };
+
+	/// @brief	Calculate the FNV-1a hash of a list of commands.
+	static uint64_t hash(const std::vector<std::string>& commands)
+	{
+		uint64_t h{ 14695981039346656037ull };
+		for (const auto& cmd : commands) {
+			for (const auto& ch : cmd) {
+				h ^= static_cast<unsigned char>(ch);
+				h *= 1099511628211ull;
+			}
+			h ^= '\n';
+			h *= 1099511628211ull;
+		}
+		return h;
+	}
+
+	/// @brief	Write a line to the checkpoint file & sync it to disk.
+	void write_line(const std::string& line)
+	{
+		(void)!::write(fd, line.data(), line.size());
+#		ifdef OS_WIN
+		_commit(fd);
+#		else
+		fsync(fd);
+#		endif
+		last_sync = std::chrono::steady_clock::now();
+	}
+
+public:
+	/**
+	 * @brief			Open a checkpoint file for a script.
+	 * @param path		Location of the checkpoint file.
+	 * @param commands	The full list of commands in the script.
+	 * @param resume	When true, the existing checkpoint is validated & its progress is kept.
+	 *\n				When false, the checkpoint file is overwritten.
+	 * @throws except	The file couldn't be opened, or the existing checkpoint belongs to a different script.
+	 */
+	Checkpoint(const std::filesystem::path& path, const std::vector<std::string>& commands, const bool& resume)
+	{
+		const auto header{ std::string{ HEADER } + ' ' + std::to_string(commands.size()) + ' ' + std::to_string(hash(commands)) };
+
+		if (resume) {
+			if (std::ifstream ifs{ path }; ifs.is_open()) {
+				std::string ln;
+				if (std::getline(ifs, ln) && ln != header)
+					throw make_exception("Checkpoint ", path, " was created by a different script; refusing to resume!");
+				// use the last complete line; a partially-written last line is ignored
+				while (std::getline(ifs, ln)) {
+					if (ifs.eof())
+						break;
+					try {
+						completed = std::stoull(ln);
+					} catch (...) {}
+				}
+			}
+		}
+
+		fd = ::open(path.string().c_str(), O_WRONLY | O_CREAT | (resume && completed > 0ull ? O_APPEND : O_TRUNC), 0644);
+		if (fd == -1)
+			throw make_exception("Failed to open checkpoint file ", path, " for writing!");
+
+		synced = completed;
+		if (!resume || completed == 0ull)
+			write_line(header + '\n');
+	}
+	Checkpoint(const Checkpoint&) = delete;
+	Checkpoint& operator=(const Checkpoint&) = delete;
+	~Checkpoint()
+	{
+		if (fd != -1) {
+			flush();
+			::close(fd);
+		}
+	}
+
+	/// @brief	Get the index of the next command to execute, including progress made before resuming.
+	size_t get_completed() const { return completed; }
+
+	/**
+	 * @brief		Record the position of the next command to execute, after the current one has completed.
+	 *\n			Progress is written once a full batch has completed, or when the batch time has elapsed.
+	 * @param next	Index of the next command. This is usually the index of the completed command plus one,
+	 *\n			unless the script jumped to a label.
+	 */
+	void acknowledge(const size_t& next)
+	{
+		completed = next;
+		if ((completed > synced ? completed - synced : synced - completed) >= BATCH_SIZE || std::chrono::steady_clock::now() - last_sync >= BATCH_TIME)
+			flush();
+	}
+
+	/// @brief	Write any unsynced progress to the checkpoint file.
+	void flush()
+	{
+		if (completed == synced)
+			return;
+		write_line(std::to_string(completed) + '\n');
+		synced = completed;
+	}
+};
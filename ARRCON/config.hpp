@@ -74,6 +74,37 @@ namespace config {
 		}
 	};
 
+	/**
+	 * @brief		Apply the delay & timeout settings from the timing header of an INI config to the Global object.
+	 *\n			These settings are atomic, so they can be changed while other threads are using them.
+	 * @param ini	The INI config.
+	 */
+	inline void load_timing(const ini::INI& ini)
+	{
+		const auto to_ms{ [](const std::optional<std::string>& str, const std::chrono::milliseconds& def) -> std::chrono::milliseconds { return ((str.has_value() && std::all_of(str.value().begin(), str.value().end(), isdigit)) ? std::chrono::milliseconds(str::stoi(str.value())) : def); } };
+		Global.command_delay = to_ms(ini.get(header::TIMING, "iCommandDelay"), Global.command_delay.load());
+		Global.receive_delay = to_ms(ini.get(header::TIMING, "iReceiveDelay"), Global.receive_delay.load());
+		Global.select_timeout = to_ms(ini.get(header::TIMING, "iSelectTimeout"), Global.select_timeout.load());
+	}
+
+	/**
+	 * @brief		Re-read the INI config while a long-running mode is active.
+	 *\n			Only the timing settings are applied, since the other settings aren't safe to change from another thread.
+	 * @param path	The location of the target config.
+	 * @throws		ex::except	The config couldn't be parsed.
+	 * @returns		bool	false when the config is missing or empty, in which case the current settings are kept.
+	 */
+	inline bool reload_ini(const std::filesystem::path& path)
+	{
+		if (!file::exists(path))
+			return false;
+		ini::INI ini{ path };
+		if (ini.empty())
+			return false;
+		load_timing(ini);
+		return true;
+	}
+
 	/**
 	 * @brief		Read the INI config and apply its settings to the Global object.
 	 * @param path	The location of the target config.
@@ -103,12 +134,11 @@ namespace config {
 			
 			Global.custom_prompt = ini.get(header::APPEARANCE, "sCustomPrompt").value_or("");
 
+			if (const auto enc{ ini.get(header::APPEARANCE, "sEncoding") }; enc.has_value())
+				Global.encoding = encoding::parse(enc.value()).value_or(Global.encoding);
+
 			// Timing Header:
-			using namespace std::chrono_literals;
-			const auto to_ms{ [](const std::optional<std::string>& str, const std::chrono::milliseconds& def) -> std::chrono::milliseconds { return ((str.has_value() && std::all_of(str.value().begin(), str.value().end(), isdigit)) ? std::chrono::milliseconds(str::stoi(str.value())) : def); } };
-			Global.command_delay = to_ms(ini.get(header::TIMING, "iCommandDelay"), Global.command_delay);
-			Global.receive_delay = to_ms(ini.get(header::TIMING, "iReceiveDelay"), Global.receive_delay);
-			Global.select_timeout = to_ms(ini.get(header::TIMING, "iSelectTimeout"), Global.select_timeout);
+			load_timing(ini);
 			Global.auto_adjust_timeouts = ini.checkv(header::TIMING, "bAutoAdjustTimeout", true);
 
 			// Target Header:
@@ -122,6 +152,14 @@ namespace config {
 			Global.allow_exit = ini.checkv(header::MISCELLANEOUS, "bInteractiveAllowExitKeyword", true);
 			Global.enable_no_response_message = ini.checkv(header::MISCELLANEOUS, "bEnableNoResponseMessage", true);
 			Global.autoDeleteHostlist = ini.checkv(header::MISCELLANEOUS, "bAutoDeleteHostlist", true);
+			Global.enable_tab_completion = !ini.checkv(header::MISCELLANEOUS, "bEnableTabCompletion", false);
+			if (const auto list{ ini.get(header::MISCELLANEOUS, "sCoalesceCommands") }; list.has_value()) {
+				Global.coalesce_commands.clear();
+				std::stringstream ss{ list.value() };
+				for (std::string cmd; std::getline(ss, cmd, ','); )
+					if (const auto name{ str::strip_line(cmd) }; !name.empty())
+						Global.coalesce_commands.emplace_back(name);
+			}
 
 			return true;
 		} catch (...) { return false; }
@@ -154,6 +192,7 @@ namespace config {
 				<< "bDisableColors = false\n"
 				<< "sCustomPrompt = \"\"\n"
 				<< "bEnableBukkitColors = true\n"
+				<< "sEncoding = \"auto\"\n"
 				<< '\n'
 				<< '[' << ::config::header::TIMING << ']' << '\n'
 				<< "iCommandDelay = 0\n"
@@ -165,6 +204,8 @@ namespace config {
 				<< "bInteractiveAllowExitKeyword = true\n"
 				<< "bEnableNoResponseMessage = true\n"
 				<< "bAutoDeleteHostlist = true\n"
+				<< "bEnableTabCompletion = true\n"
+				<< "sCoalesceCommands = \"list,status,help,players,showplayers\"\n"
 				<< '\n';
 		}
 		else { // use current settings
@@ -181,17 +222,25 @@ namespace config {
 				<< "bDisableColors = " << Global.no_color << '\n'
 				<< "sCustomPrompt = \"" << Global.custom_prompt << "\"\n"
 				<< "bEnableBukkitColors = " << Global.enable_bukkit_color_support << '\n'
+				<< "sEncoding = \"" << encoding::to_string(Global.encoding) << "\"\n"
 				<< '\n'
 				<< '[' << ::config::header::TIMING << ']' << '\n'
-				<< "iCommandDelay = " << Global.command_delay.count() << '\n'
-				<< "iReceiveDelay = " << Global.receive_delay.count() << '\n'
-				<< "iSelectTimeout = " << Global.select_timeout.count() << '\n'
+				<< "iCommandDelay = " << Global.command_delay.load().count() << '\n'
+				<< "iReceiveDelay = " << Global.receive_delay.load().count() << '\n'
+				<< "iSelectTimeout = " << Global.select_timeout.load().count() << '\n'
 				<< "bAutoAdjustTimeout = " << Global.auto_adjust_timeouts << '\n'
 				<< '\n'
 				<< '[' << ::config::header::MISCELLANEOUS << ']' << '\n'
 				<< "bInteractiveAllowExitKeyword = " << Global.allow_exit << '\n'
 				<< "bEnableNoResponseMessage = " << Global.enable_no_response_message << '\n'
 				<< "bAutoDeleteHostlist = " << Global.autoDeleteHostlist << '\n'
+				<< "bEnableTabCompletion = " << Global.enable_tab_completion << '\n'
+				<< "sCoalesceCommands = \"" << [] {
+					std::string list;
+					for (const auto& cmd : Global.coalesce_commands)
+						list += (list.empty() ? "" : ",") + cmd;
+					return list;
+				}() << "\"\n"
 				<< '\n';
 		}
 		return file::write_to(path, std::move(ss));
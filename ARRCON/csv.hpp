@@ -0,0 +1,156 @@
+/**
+ * @file	csv.hpp
+ * @author	radj307
+ * @brief	Contains a streaming CSV/TSV reader & the command template expander used by [--template].
+ */
+#pragma once
+#include <make_exception.hpp>
+
+#include <algorithm>
+#include <istream>
+#include <string>
+#include <vector>
+
+ /**
+  * @namespace	csv
+  * @brief		Contains the CSV reader & command template objects.
+  */
+namespace csv {
+	/**
+	 * @class	Reader
+	 * @brief	Reads delimited rows from a stream one at a time, so memory usage doesn't depend on the number of rows.
+	 *\n		Supports quoted fields (which may contain delimiters, newlines & doubled quotes) and CRLF line endings.
+	 */
+	class Reader {
+		std::istream& is;
+		char delim;
+
+	public:
+		/**
+		 * @brief			Constructor.
+		 * @param is		Input stream to read rows from.
+		 * @param delim		Field delimiter; ',' for CSV, '\t' for TSV.
+		 */
+		Reader(std::istream& is, const char& delim = ',') : is{ is }, delim{ delim } {}
+
+		/**
+		 * @brief			Read the next row.
+		 * @param fields	Receives the row's fields. Existing elements are reused to avoid reallocating.
+		 * @returns			bool
+		 *\n				false when the end of the stream was reached.
+		 */
+		bool next(std::vector<std::string>& fields)
+		{
+			size_t count{ 0ull };
+			const auto field{ [&]() -> std::string& {
+				if (count == fields.size())
+					fields.emplace_back();
+				auto& f{ fields[count++] };
+				f.clear();
+				return f;
+			} };
+
+			int ch{ is.get() };
+			if (ch == std::char_traits<char>::eof())
+				return false;
+
+			std::string* current{ &field() };
+			bool quoted{ false };
+			for (; ch != std::char_traits<char>::eof(); ch = is.get()) {
+				const char c{ static_cast<char>(ch) };
+				if (quoted) {
+					if (c == '"') {
+						if (is.peek() == '"')
+							current->push_back(static_cast<char>(is.get()));
+						else quoted = false;
+					}
+					else current->push_back(c);
+				}
+				else if (c == '"' && current->empty())
+					quoted = true;
+				else if (c == delim)
+					current = &field();
+				else if (c == '\n')
+					break;
+				else if (c == '\r' && is.peek() == '\n')
+					continue;
+				else current->push_back(c);
+			}
+			fields.resize(count);
+			return true;
+		}
+	};
+
+	/**
+	 * @class	Template
+	 * @brief	A command template with {placeholders} that is compiled once & expanded for each row.
+	 *\n		Placeholders may be a column name from the header row, or a zero-based column index.
+	 *\n		Literal braces are written as "{{" & "}}".
+	 */
+	class Template {
+		struct Segment {
+			std::string literal;
+			/// @brief	Column index to insert after the literal, or npos.
+			size_t column;
+		};
+		std::vector<Segment> segments;
+
+	public:
+		/**
+		 * @brief			Compile a template.
+		 * @param text		The template string.
+		 * @param header	Column names from the header row.
+		 * @throws except	A placeholder is unterminated or doesn't match any column.
+		 */
+		Template(const std::string& text, const std::vector<std::string>& header)
+		{
+			std::string literal;
+			for (size_t i{ 0ull }; i < text.size(); ++i) {
+				const char c{ text[i] };
+				if ((c == '{' || c == '}') && i + 1ull < text.size() && text[i + 1ull] == c) {
+					literal.push_back(c);
+					++i;
+				}
+				else if (c == '{') {
+					const auto close{ text.find('}', i) };
+					if (close == std::string::npos)
+						throw make_exception("Unterminated placeholder in template \"", text, "\" at position ", i, '!');
+					const auto name{ text.substr(i + 1ull, close - i - 1ull) };
+
+					size_t column{ std::string::npos };
+					for (size_t col{ 0ull }; col < header.size(); ++col) {
+						if (header[col] == name) {
+							column = col;
+							break;
+						}
+					}
+					if (column == std::string::npos) {
+						if (!name.empty() && std::all_of(name.begin(), name.end(), isdigit))
+							column = std::stoull(name);
+						else throw make_exception("Template placeholder \"{", name, "}\" doesn't match any column in the header!");
+					}
+					segments.emplace_back(Segment{ std::move(literal), column });
+					literal.clear();
+					i = close;
+				}
+				else literal.push_back(c);
+			}
+			segments.emplace_back(Segment{ std::move(literal), std::string::npos });
+		}
+
+		/**
+		 * @brief			Expand the template for a row.
+		 * @param fields	The row's fields. Missing columns expand to an empty string.
+		 * @param out		Receives the expanded command. Its capacity is reused between rows.
+		 */
+		void expand(const std::vector<std::string>& fields, std::string& out) const
+		{
+			out.clear();
+			for (const auto& [literal, column] : segments) {
+				out += literal;
+				if (column < fields.size())
+					out += fields[column];
+			}
+		}
+	};
+}
@@ -0,0 +1,254 @@
+/**
+ * @file	encoding.hpp
+ * @author	radj307
+ * @brief	Contains the UTF-8 validator & the legacy encoding transcoder that is applied to response bodies before they are printed.
+ *\n		Runs of ASCII are skipped 16 bytes at a time with SSE2 (or 8 bytes at a time without it), so responses that are
+ *\n		already valid are passed through without being copied.
+ */
+#pragma once
+#include <bit>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARRCON_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+ /**
+  * @namespace	encoding
+  * @brief		Contains functions used to validate & transcode text received from the server.
+  */
+namespace encoding {
+	/**
+	 * @enum	Encoding
+	 * @brief	The encodings that response bodies can be interpreted as.
+	 */
+	enum class Encoding : unsigned char {
+		/// @brief	UTF-8; invalid sequences are replaced with U+FFFD.
+		UTF8,
+		/// @brief	ISO-8859-1.
+		LATIN1,
+		/// @brief	Windows-1252.
+		CP1252,
+		/// @brief	UTF-8 when the response is valid UTF-8, otherwise Windows-1252.
+		AUTO,
+	};
+
+	/**
+	 * @brief		Parse the name of an encoding.
+	 * @param name	"utf8", "latin1", "cp1252", or "auto". Dashes & case are ignored.
+	 * @returns		std::optional<Encoding>
+	 *\n			std::nullopt when the name isn't recognized.
+	 */
+	inline std::optional<Encoding> parse(const std::string_view& name)
+	{
+		std::string lower;
+		for (const auto& ch : name)
+			if (ch != '-' && ch != '_')
+				lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
+		if (lower == "utf8")
+			return Encoding::UTF8;
+		else if (lower == "latin1" || lower == "iso88591")
+			return Encoding::LATIN1;
+		else if (lower == "cp1252" || lower == "windows1252")
+			return Encoding::CP1252;
+		else if (lower == "auto")
+			return Encoding::AUTO;
+		return std::nullopt;
+	}
+
+	/**
+	 * @brief		Get the name of an encoding.
+	 * @param enc	The encoding.
+	 * @returns		const char*
+	 */
+	inline constexpr const char* to_string(const Encoding& enc)
+	{
+		switch (enc) {
+		case Encoding::UTF8:
+			return "utf8";
+		case Encoding::LATIN1:
+			return "latin1";
+		case Encoding::CP1252:
+			return "cp1252";
+		case Encoding::AUTO: [[fallthrough]];
+		default:
+			return "auto";
+		}
+	}
+
+	/// @brief	The UTF-8 encoding of U+FFFD REPLACEMENT CHARACTER.
+	inline constexpr const std::string_view REPLACEMENT{ "\xEF\xBF\xBD" };
+
+	/// @brief	Code points of the Windows-1252 characters 0x80-0x9F. Undefined characters are 0.
+	inline constexpr const uint16_t CP1252_HIGH[32]{
+		0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+		0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178,
+	};
+
+	/**
+	 * @brief		Find the length of the run of ASCII characters at the beginning of a buffer.
+	 * @param data	Input buffer.
+	 * @param size	Size of the input buffer.
+	 * @returns		size_t
+	 *\n			The index of the first non-ASCII byte, or size when there aren't any.
+	 */
+	inline size_t ascii_prefix(const char* data, const size_t& size)
+	{
+		size_t i{ 0ull };
+#		ifdef ARRCON_HAS_SSE2
+		for (; i + 16ull <= size; i += 16ull) {
+			if (const auto mask{ static_cast<unsigned>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)))) }; mask != 0u)
+				return i + static_cast<size_t>(std::countr_zero(mask));
+		}
+#		endif
+		for (uint64_t word; i + 8ull <= size; i += 8ull) {
+			std::memcpy(&word, data + i, sizeof(word));
+			if ((word & 0x8080808080808080ull) != 0ull)
+				break;
+		}
+		for (; i < size; ++i)
+			if ((static_cast<unsigned char>(data[i]) & 0x80u) != 0u)
+				break;
+		return i;
+	}
+
+	/**
+	 * @brief			Check the UTF-8 sequence at the beginning of a buffer.
+	 * @param data		Input buffer.
+	 * @param size		Size of the input buffer. Must be at least 1.
+	 * @param subpart	Receives the number of bytes to skip. For an invalid sequence, this is the length of its
+	 *\n				longest valid prefix (at least 1), which is replaced by a single U+FFFD.
+	 * @returns			bool	true when the sequence is valid.
+	 */
+	inline bool check_sequence(const unsigned char* data, const size_t& size, size_t& subpart)
+	{
+		const auto lead{ data[0] };
+		size_t length;
+		unsigned char lo{ 0x80 }, hi{ 0xBF };
+		if (lead < 0x80)
+			length = 1ull;
+		else if (lead >= 0xC2 && lead <= 0xDF)
+			length = 2ull;
+		else if (lead >= 0xE0 && lead <= 0xEF) {
+			length = 3ull;
+			if (lead == 0xE0)
+				lo = 0xA0; // overlong
+			else if (lead == 0xED)
+				hi = 0x9F; // surrogates
+		}
+		else if (lead >= 0xF0 && lead <= 0xF4) {
+			length = 4ull;
+			if (lead == 0xF0)
+				lo = 0x90; // overlong
+			else if (lead == 0xF4)
+				hi = 0x8F; // above U+10FFFF
+		}
+		else {
+			subpart = 1ull;
+			return false;
+		}
+		for (size_t i{ 1ull }; i < length; ++i) {
+			if (i >= size || data[i] < lo || data[i] > hi) {
+				subpart = i;
+				return false;
+			}
+			lo = 0x80;
+			hi = 0xBF;
+		}
+		subpart = length;
+		return true;
+	}
+
+	/**
+	 * @brief		Find the first invalid UTF-8 sequence in a string.
+	 * @param text	Input text.
+	 * @returns		size_t
+	 *\n			The index of the first invalid sequence, or the size of text when it is entirely valid.
+	 */
+	inline size_t find_invalid_utf8(const std::string_view& text)
+	{
+		const auto* data{ reinterpret_cast<const unsigned char*>(text.data()) };
+		for (size_t i{ 0ull }, subpart; ; i += subpart) {
+			i += ascii_prefix(text.data() + i, text.size() - i);
+			if (i == text.size())
+				return i;
+			if (!check_sequence(data + i, text.size() - i, subpart))
+				return i;
+		}
+	}
+
+	/**
+	 * @brief			Append the UTF-8 encoding of a code point to a string.
+	 * @param out		Output string.
+	 * @param codepoint	A code point less than U+10000.
+	 */
+	inline void append_utf8(std::string& out, const uint16_t& codepoint)
+	{
+		if (codepoint < 0x80)
+			out.push_back(static_cast<char>(codepoint));
+		else if (codepoint < 0x800) {
+			out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+			out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+		}
+		else {
+			out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+			out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+		}
+	}
+
+	/**
+	 * @brief		Convert text to valid UTF-8.
+	 *\n			Text that is already valid (including any text that is entirely ASCII) isn't copied.
+	 * @param text	Input text.
+	 * @param enc	The encoding to interpret the text as.
+	 * @param out	Receives the converted text when it has to be copied. Its capacity is reused between calls.
+	 * @returns		std::string_view
+	 *\n			A view of text when it didn't need converting; otherwise a view of out.
+	 */
+	inline std::string_view to_utf8(const std::string_view& text, const Encoding& enc, std::string& out)
+	{
+		const auto* data{ reinterpret_cast<const unsigned char*>(text.data()) };
+
+		size_t i{ enc == Encoding::UTF8 || enc == Encoding::AUTO ? find_invalid_utf8(text) : ascii_prefix(text.data(), text.size()) };
+		if (i == text.size())
+			return text;
+
+		out.assign(text.substr(0ull, i));
+		switch (enc) {
+		case Encoding::UTF8:
+			for (size_t subpart; i < text.size(); i += subpart) {
+				if (check_sequence(data + i, text.size() - i, subpart))
+					out.append(text.substr(i, subpart));
+				else out += REPLACEMENT;
+			}
+			break;
+		case Encoding::AUTO:
+			// not valid UTF-8, so the whole response is treated as Windows-1252
+			i = ascii_prefix(text.data(), i);
+			out.resize(i);
+			[[fallthrough]];
+		case Encoding::CP1252:
+			for (; i < text.size(); ++i) {
+				if (data[i] >= 0x80 && data[i] <= 0x9F) {
+					if (const auto codepoint{ CP1252_HIGH[data[i] - 0x80] }; codepoint != 0)
+						append_utf8(out, codepoint);
+					else out += REPLACEMENT;
+				}
+				else append_utf8(out, data[i]);
+			}
+			break;
+		case Encoding::LATIN1:
+			for (; i < text.size(); ++i)
+				append_utf8(out, data[i]);
+			break;
+		}
+		return out;
+	}
+}
@@ -5,6 +5,7 @@
  */
 #pragma once
 #include "globals.h"
+#include "net/flight.hpp"
 
 #include <make_exception.hpp>
 #include <str.hpp>
@@ -34,6 +35,7 @@ struct socket_except final : public ex::except { socket_except(auto&& message) :
 /// @brief	Make a socket exception
 static socket_except socket_exception(const std::string& function_name, const std::string& message, const int& errorCode, const std::string& errorMsg)
 {
+	net::flight::record_and_dump(net::flight::Event::SOCKET_FAILURE, 0, 0, errorCode);
 	return ex::make_custom_exception<socket_except>(
 		"Socket Error:  ", message, '\n',
 		indent(10), "Function Name:         ", function_name, '\n',
@@ -43,6 +45,7 @@ static socket_except socket_exception(const std::string& function_name, const st
 }/// @brief	Make an inline socket exception
 static socket_except socket_exception(const std::string& function_name, const std::string& message)
 {
+	net::flight::record_and_dump(net::flight::Event::SOCKET_FAILURE);
 	return ex::make_custom_exception<socket_except>(function_name, ":  ", message);
 }
 
@@ -0,0 +1,153 @@
+/**
+ * @file	filter.hpp
+ * @author	radj307
+ * @brief	Contains the response line filter used by [--grep], [--exclude] & the "@grep"/"@exclude" script directives.
+ *\n		Patterns are compiled once & matched against each line of a response before it is rendered,
+ *\n		so piping through external tools to strip colors & filter lines is unnecessary.
+ */
+#pragma once
+#include <make_exception.hpp>
+
+#include <cstring>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+ /**
+  * @namespace	filter
+  * @brief		Contains the response line filter.
+  */
+namespace filter {
+	/**
+	 * @brief		Remove Minecraft color codes from a line of UTF-8 text.
+	 * @param line	Input text.
+	 * @param out	Receives the text without color codes.
+	 * @returns		std::string_view
+	 *\n			A view of line when it doesn't contain any color codes; otherwise a view of out.
+	 */
+	inline std::string_view strip_colors(const std::string_view& line, std::string& out)
+	{
+		if (std::memchr(line.data(), '\xA7', line.size()) == nullptr)
+			return line;
+		out.clear();
+		for (size_t i{ 0ull }; i < line.size(); ++i) {
+			// section sign (U+00A7) followed by a color code
+			if (line[i] == '\xC2' && i + 1ull < line.size() && line[i + 1ull] == '\xA7')
+				i += 2ull;
+			else out.push_back(line[i]);
+		}
+		return out;
+	}
+
+	/**
+	 * @brief			Call a function for each line in a block of text.
+	 *\n				Trailing carriage returns are excluded from each line.
+	 * @param text		Input text.
+	 * @param func		Function that accepts a std::string_view.
+	 */
+	template<typename Func>
+	inline void for_each_line(const std::string_view& text, Func&& func)
+	{
+		for (size_t pos{ 0ull }; pos < text.size(); ) {
+			auto end{ text.find('\n', pos) };
+			if (end == std::string_view::npos)
+				end = text.size();
+			auto line_end{ end };
+			if (line_end > pos && text[line_end - 1ull] == '\r')
+				--line_end;
+			func(text.substr(pos, line_end - pos));
+			pos = end + 1ull;
+		}
+	}
+
+	/**
+	 * @class	Pattern
+	 * @brief	A compiled search pattern.
+	 *\n		Patterns without any regular expression metacharacters are searched for literally,
+	 *\n		which avoids the cost of the regex engine for the common case.
+	 */
+	class Pattern {
+		std::string text;
+		bool literal;
+		std::regex regex;
+
+	public:
+		/**
+		 * @brief			Compile a pattern.
+		 * @param pattern	A literal string or an ECMAScript regular expression.
+		 * @throws except	The regular expression is invalid.
+		 */
+		Pattern(const std::string& pattern) : text{ pattern }, literal{ pattern.find_first_of("\\^$.|?*+()[]{}") == std::string::npos }
+		{
+			if (!literal) {
+				try {
+					regex = std::regex{ pattern, std::regex::ECMAScript | std::regex::optimize };
+				} catch (const std::regex_error& ex) {
+					throw make_exception("Invalid filter pattern \"", pattern, "\": ", ex.what());
+				}
+			}
+		}
+
+		/// @brief	Get the pattern as it was specified.
+		const std::string& str() const { return text; }
+
+		/**
+		 * @brief		Check if the pattern matches anywhere in a line.
+		 * @param line	Line of text without color codes.
+		 * @returns		bool
+		 */
+		bool search(const std::string_view& line) const
+		{
+			if (literal)
+				return line.find(text) != std::string_view::npos;
+			return std::regex_search(line.begin(), line.end(), regex);
+		}
+	};
+
+	/**
+	 * @class	Filter
+	 * @brief	Selects response lines that match at least one include pattern (when any are specified) & no exclude patterns.
+	 */
+	class Filter {
+		std::vector<Pattern> includes, excludes;
+
+	public:
+		/// @brief	Add a pattern that lines must match to be shown.
+		void include(const std::string& pattern) { includes.emplace_back(pattern); }
+		/// @brief	Add a pattern that hides matching lines.
+		void exclude(const std::string& pattern) { excludes.emplace_back(pattern); }
+
+		/// @brief	Check if the filter doesn't contain any patterns, in which case every line passes.
+		bool empty() const { return includes.empty() && excludes.empty(); }
+
+		/// @brief	Remove all patterns.
+		void clear()
+		{
+			includes.clear();
+			excludes.clear();
+		}
+
+		/**
+		 * @brief		Check if a line passes the filter.
+		 * @param line	Line of text. Color codes are ignored when matching.
+		 * @returns		bool
+		 */
+		bool passes(const std::string_view& line) const
+		{
+			if (empty())
+				return true;
+			thread_local std::string buffer;
+			const auto text{ strip_colors(line, buffer) };
+			for (const auto& pattern : excludes)
+				if (pattern.search(text))
+					return false;
+			if (includes.empty())
+				return true;
+			for (const auto& pattern : includes)
+				if (pattern.search(text))
+					return true;
+			return false;
+		}
+	};
+}
@@ -6,6 +6,8 @@
 #pragma once
 #include "version.h"
 #include "net/objects/HostInfo.hpp"
+#include "filter.hpp"
+#include "encoding.hpp"
 
 #include <color-values.h>
 #include <palette.hpp>
@@ -14,6 +16,8 @@
 #include <env.hpp>
 
 #include <thread>
+#include <string>
+#include <vector>
 #include <cmath>
 #include <sys/socket.h>
 #include <chrono>
@@ -120,6 +124,13 @@ static struct {
 	/// @brief	When true, a message is printed to STDOUT when a command didn't provoke any response from the server, indicating it was invalid.
 	bool enable_no_response_message{ true };
 
+	/// @brief	When true, interactive mode fetches command & player names in the background for tab completion.
+	bool enable_tab_completion{ true };
+
+	/// @brief	Read-only commands that long-running modes may coalesce: when an identical command is already in flight to
+	///			the same host, later callers wait for its response instead of sending another. Matched by the first word.
+	std::vector<std::string> coalesce_commands{ "list", "status", "help", "players", "showplayers" };
+
 	/// @brief	Allows or disallows ARRCON from being able to create or delete files automatically, such as when the hostlist is empty.
 	bool autoDeleteHostlist{ true };
 
@@ -137,14 +148,17 @@ static struct {
 	/// @brief	When true, support for minecraft bukkit colors is enabled, and the color mapped to UIElem::PACKET will have no effect.
 	bool enable_bukkit_color_support{ true };
 
+	/// @brief	The encoding that response bodies are interpreted as before they're converted to UTF-8 & printed.
+	encoding::Encoding encoding{ encoding::Encoding::AUTO };
+
 	/// @brief	Delay between sending each command when using commandline mode.
-	std::chrono::milliseconds command_delay{ 0ll };
+	std::atomic<std::chrono::milliseconds> command_delay{ std::chrono::milliseconds{ 0ll } };
 
 	/// @brief	Delay between receive calls. Changing this may break or fix multi-packet response handling. (Default is 10)
-	std::chrono::milliseconds receive_delay{ 10ll };
+	std::atomic<std::chrono::milliseconds> receive_delay{ std::chrono::milliseconds{ 10ll } };
 
 	/// @brief	Amount of time before the select() function times out.
-	std::chrono::milliseconds select_timeout{ 250ll };
+	std::atomic<std::chrono::milliseconds> select_timeout{ std::chrono::milliseconds{ 250ll } };
 
 	/// @brief	Whether to automatically adjust timeouts or not
 	bool auto_adjust_timeouts{ false };
@@ -157,6 +171,9 @@ static struct {
 
 	/// @brief	When entries are present, the user specified at least one [-f|--file] option.
 	std::vector<std::string> scriptfiles{};
+
+	/// @brief	Response line filter specified with [--grep] & [--exclude]. Applies to all printed responses.
+	filter::Filter filter{};
 } Global;
 
 inline std::ostream& operator<<(std::ostream& os, const Environment& e)
@@ -0,0 +1,435 @@
+/**
+ * @file	json.hpp
+ * @author	radj307
+ * @brief	Contains a minimal JSON reader & writer used by the gateway & server modes.
+ */
+#pragma once
+#include <make_exception.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+ /**
+  * @namespace	json
+  * @brief		Contains functions & objects used to read & produce JSON text.
+  */
+namespace json {
+	/**
+	 * @brief		Append a string to the output as a quoted JSON string, escaping characters as necessary.
+	 *\n			The input must be valid UTF-8.
+	 * @param out	Output string.
+	 * @param str	Input string.
+	 */
+	inline void append_string(std::string& out, const std::string_view& str)
+	{
+		out.push_back('"');
+		for (const auto& ch : str) {
+			switch (ch) {
+			case '"':
+				out += "\\\"";
+				break;
+			case '\\':
+				out += "\\\\";
+				break;
+			case '\n':
+				out += "\\n";
+				break;
+			case '\r':
+				out += "\\r";
+				break;
+			case '\t':
+				out += "\\t";
+				break;
+			default:
+				if (static_cast<unsigned char>(ch) < 0x20) {
+					char buf[7];
+					std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(ch));
+					out += buf;
+				}
+				else out.push_back(ch);
+				break;
+			}
+		}
+		out.push_back('"');
+	}
+
+	/**
+	 * @class	Object
+	 * @brief	Builds a JSON object one member at a time.
+	 */
+	class Object {
+		std::string buffer{ "{" };
+
+		/// @brief	Append a member's key.
+		Object& key(const std::string_view& name)
+		{
+			if (buffer.size() > 1ull)
+				buffer.push_back(',');
+			append_string(buffer, name);
+			buffer.push_back(':');
+			return *this;
+		}
+
+	public:
+		/// @brief	Add a string member.
+		Object& add(const std::string_view& name, const std::string_view& value)
+		{
+			key(name);
+			append_string(buffer, value);
+			return *this;
+		}
+		/// @brief	Add a string member.
+		Object& add(const std::string_view& name, const char* value) { return add(name, std::string_view{ value }); }
+		/// @brief	Add a string member.
+		Object& add(const std::string_view& name, const std::string& value) { return add(name, std::string_view{ value }); }
+		/// @brief	Add a boolean member.
+		Object& add(const std::string_view& name, const bool& value)
+		{
+			key(name);
+			buffer += value ? "true" : "false";
+			return *this;
+		}
+		/// @brief	Add a number member.
+		template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<T, bool>)
+		Object& add(const std::string_view& name, const T& value)
+		{
+			key(name);
+			if constexpr (std::is_floating_point_v<T>) {
+				char buf[32];
+				std::snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(value));
+				buffer += buf;
+			}
+			else buffer += std::to_string(value);
+			return *this;
+		}
+		/// @brief	Add a member whose value is already valid JSON text, such as an array or a nested object.
+		Object& add_raw(const std::string_view& name, const std::string_view& json)
+		{
+			key(name);
+			buffer += json;
+			return *this;
+		}
+
+		/// @brief	Get the finished JSON text.
+		std::string str() const { return buffer + '}'; }
+	};
+
+	/**
+	 * @struct	Value
+	 * @brief	A parsed JSON value.
+	 */
+	struct Value {
+		enum class Type : uint8_t {
+			Null,
+			Boolean,
+			Number,
+			String,
+			Array,
+			Object,
+		};
+
+		Type type{ Type::Null };
+		bool boolean{ false };
+		double number{ 0.0 };
+		std::string string;
+		std::vector<Value> array;
+		std::map<std::string, Value, std::less<>> object;
+
+		bool is_null() const { return type == Type::Null; }
+		bool is_number() const { return type == Type::Number; }
+		bool is_string() const { return type == Type::String; }
+		bool is_object() const { return type == Type::Object; }
+
+		/**
+		 * @brief		Get an object member.
+		 * @param name	The member's name.
+		 * @returns		const Value*
+		 *\n			nullptr when this isn't an object, or has no member with that name.
+		 */
+		const Value* find(const std::string_view& name) const
+		{
+			if (type != Type::Object)
+				return nullptr;
+			if (const auto it{ object.find(name) }; it != object.end())
+				return &it->second;
+			return nullptr;
+		}
+	};
+
+	/**
+	 * @class	Parser
+	 * @brief	Recursive-descent parser for JSON text.
+	 */
+	class Parser {
+		/// @brief	Maximum depth of nested arrays & objects.
+		static constexpr const size_t MAX_DEPTH{ 64ull };
+
+		std::string_view text;
+		size_t pos{ 0ull };
+
+		/// @brief	Skip whitespace, then get the next character without consuming it.
+		char peek()
+		{
+			while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r'))
+				++pos;
+			return pos < text.size() ? text[pos] : '\0';
+		}
+
+		/// @brief	Consume the expected character, or throw.
+		void expect(const char ch)
+		{
+			if (peek() != ch)
+				throw make_exception("Invalid JSON: expected '", ch, "' at offset ", pos, '!');
+			++pos;
+		}
+
+		/// @brief	Consume a literal such as "true", or throw.
+		void literal(const std::string_view& word)
+		{
+			if (text.substr(pos, word.size()) != word)
+				throw make_exception("Invalid JSON: unexpected character at offset ", pos, '!');
+			pos += word.size();
+		}
+
+		/// @brief	Append a code point to a string as UTF-8.
+		static void append_code_point(std::string& out, const uint32_t cp)
+		{
+			if (cp < 0x80)
+				out.push_back(static_cast<char>(cp));
+			else if (cp < 0x800) {
+				out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+				out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+			}
+			else if (cp < 0x10000) {
+				out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+				out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+			}
+			else {
+				out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+				out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+			}
+		}
+
+		/// @brief	Parse the 4 hex digits of a \u escape sequence.
+		uint32_t hex4()
+		{
+			if (pos + 4ull > text.size())
+				throw make_exception("Invalid JSON: truncated escape sequence at offset ", pos, '!');
+			uint32_t value{ 0u };
+			for (size_t i{ 0ull }; i < 4ull; ++i, ++pos) {
+				const char c{ text[pos] };
+				value <<= 4;
+				if (c >= '0' && c <= '9')
+					value |= static_cast<uint32_t>(c - '0');
+				else if (c >= 'a' && c <= 'f')
+					value |= static_cast<uint32_t>(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F')
+					value |= static_cast<uint32_t>(c - 'A' + 10);
+				else throw make_exception("Invalid JSON: invalid escape sequence at offset ", pos, '!');
+			}
+			return value;
+		}
+
+		std::string parse_string()
+		{
+			expect('"');
+			std::string out;
+			while (true) {
+				if (pos >= text.size())
+					throw make_exception("Invalid JSON: unterminated string!");
+				const char c{ text[pos++] };
+				if (c == '"')
+					return out;
+				if (c != '\\') {
+					out.push_back(c);
+					continue;
+				}
+				if (pos >= text.size())
+					throw make_exception("Invalid JSON: unterminated string!");
+				switch (const char esc{ text[pos++] }) {
+				case '"': case '\\': case '/':
+					out.push_back(esc);
+					break;
+				case 'b':
+					out.push_back('\b');
+					break;
+				case 'f':
+					out.push_back('\f');
+					break;
+				case 'n':
+					out.push_back('\n');
+					break;
+				case 'r':
+					out.push_back('\r');
+					break;
+				case 't':
+					out.push_back('\t');
+					break;
+				case 'u': {
+					uint32_t cp{ hex4() };
+					if (cp >= 0xD800 && cp <= 0xDBFF && text.substr(pos, 2ull) == "\\u") {
+						pos += 2ull;
+						const uint32_t low{ hex4() };
+						if (low >= 0xDC00 && low <= 0xDFFF)
+							cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+						else cp = 0xFFFD;
+					}
+					else if (cp >= 0xD800 && cp <= 0xDFFF)
+						cp = 0xFFFD;
+					append_code_point(out, cp);
+					break;
+				}
+				default:
+					throw make_exception("Invalid JSON: invalid escape sequence at offset ", pos - 1ull, '!');
+				}
+			}
+		}
+
+		Value parse_value(const size_t depth)
+		{
+			if (depth > MAX_DEPTH)
+				throw make_exception("Invalid JSON: nested too deeply!");
+			Value value;
+			switch (peek()) {
+			case '{':
+				++pos;
+				value.type = Value::Type::Object;
+				if (peek() == '}') {
+					++pos;
+					break;
+				}
+				do {
+					auto name{ parse_string() };
+					expect(':');
+					value.object.insert_or_assign(std::move(name), parse_value(depth + 1ull));
+				} while (peek() == ',' && ++pos);
+				expect('}');
+				break;
+			case '[':
+				++pos;
+				value.type = Value::Type::Array;
+				if (peek() == ']') {
+					++pos;
+					break;
+				}
+				do {
+					value.array.emplace_back(parse_value(depth + 1ull));
+				} while (peek() == ',' && ++pos);
+				expect(']');
+				break;
+			case '"':
+				value.type = Value::Type::String;
+				value.string = parse_string();
+				break;
+			case 't':
+				literal("true");
+				value.type = Value::Type::Boolean;
+				value.boolean = true;
+				break;
+			case 'f':
+				literal("false");
+				value.type = Value::Type::Boolean;
+				break;
+			case 'n':
+				literal("null");
+				break;
+			default: {
+				const std::string number{ text.substr(pos, text.find_first_not_of("+-.0123456789eE", pos) - pos) };
+				char* end{ nullptr };
+				value.number = std::strtod(number.c_str(), &end);
+				if (number.empty() || end != number.c_str() + number.size())
+					throw make_exception("Invalid JSON: unexpected character at offset ", pos, '!');
+				value.type = Value::Type::Number;
+				pos += number.size();
+				break;
+			}
+			}
+			return value;
+		}
+
+	public:
+		Parser(const std::string_view& text) : text{ text } {}
+
+		/**
+		 * @brief			Parse the entire text as a single JSON value.
+		 * @throws except	The text isn't valid JSON.
+		 * @returns			Value
+		 */
+		Value parse()
+		{
+			auto value{ parse_value(0ull) };
+			if (peek() != '\0')
+				throw make_exception("Invalid JSON: unexpected trailing characters at offset ", pos, '!');
+			return value;
+		}
+	};
+
+	/**
+	 * @brief			Parse JSON text.
+	 * @param text		The JSON text.
+	 * @throws except	The text isn't valid JSON.
+	 * @returns			Value
+	 */
+	inline Value parse(const std::string_view& text)
+	{
+		return Parser{ text }.parse();
+	}
+
+	/**
+	 * @brief		Append a parsed value to the output as JSON text.
+	 * @param out	Output string.
+	 * @param value	The value to append.
+	 */
+	inline void append_value(std::string& out, const Value& value)
+	{
+		switch (value.type) {
+		case Value::Type::Null:
+			out += "null";
+			break;
+		case Value::Type::Boolean:
+			out += value.boolean ? "true" : "false";
+			break;
+		case Value::Type::Number: {
+			char buf[32];
+			std::snprintf(buf, sizeof(buf), "%.17g", value.number);
+			out += buf;
+			break;
+		}
+		case Value::Type::String:
+			append_string(out, value.string);
+			break;
+		case Value::Type::Array:
+			out.push_back('[');
+			for (size_t i{ 0ull }; i < value.array.size(); ++i) {
+				if (i != 0ull)
+					out.push_back(',');
+				append_value(out, value.array[i]);
+			}
+			out.push_back(']');
+			break;
+		case Value::Type::Object: {
+			out.push_back('{');
+			bool first{ true };
+			for (const auto& [name, member] : value.object) {
+				if (!first)
+					out.push_back(',');
+				first = false;
+				append_string(out, name);
+				out.push_back(':');
+				append_value(out, member);
+			}
+			out.push_back('}');
+			break;
+		}
+		}
+	}
+}
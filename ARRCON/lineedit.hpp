@@ -0,0 +1,168 @@
+/**
+ * @file	lineedit.hpp
+ * @author	radj307
+ * @brief	Contains the LineEditor object, a minimal line editor with tab completion used by interactive mode.
+ *\n		When STDIN isn't a terminal, or on Windows, it falls back to std::getline.
+ */
+#pragma once
+#include <sysarch.h>
+
+#include <concepts>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifndef OS_WIN
+#include <cerrno>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @class	LineEditor
+ * @brief	Reads lines from the terminal in non-canonical mode so that the tab key can complete the current word.
+ *\n		Supports backspace, Ctrl+U (clear line), Ctrl+W (delete word) & Ctrl+D (end of input on an empty line).
+ *\n		Pressing tab once completes the longest common prefix of the candidates; pressing it again lists them.
+ */
+class LineEditor {
+public:
+	/**
+	 * @brief	Function that returns completion candidates.
+	 *\n		Receives the word being completed & its index within the line (0 for the command name).
+	 */
+	using Completer = std::function<std::vector<std::string>(const std::string&, size_t)>;
+
+private:
+	Completer completer;
+
+	/// @brief	Redraw the current line after the prompt.
+	static void redraw(const std::string& prompt, const std::string& line)
+	{
+		(std::cout << "\r\x1b[K" << prompt << line).flush();
+	}
+
+	/// @brief	Complete the last word in the line.
+	void complete(const std::string& prompt, std::string& line, bool& listed) const
+	{
+		const auto word_begin{ line.find_last_of(' ') == std::string::npos ? 0ull : line.find_last_of(' ') + 1ull };
+		const auto word{ line.substr(word_begin) };
+		size_t index{ 0ull }; // number of words before the one being completed
+		for (size_t i{ 0ull }; i < word_begin; ++i)
+			if (line[i] != ' ' && (i == 0ull || line[i - 1ull] == ' '))
+				++index;
+
+		const auto candidates{ completer(word, index) };
+		if (candidates.empty())
+			return;
+
+		// find the longest common prefix of every candidate
+		auto prefix{ candidates.front() };
+		for (const auto& candidate : candidates) {
+			size_t i{ 0ull };
+			while (i < prefix.size() && i < candidate.size() && prefix[i] == candidate[i])
+				++i;
+			prefix.resize(i);
+		}
+
+		if (candidates.size() == 1ull)
+			line = line.substr(0ull, word_begin) + prefix + ' ';
+		else if (prefix.size() > word.size())
+			line = line.substr(0ull, word_begin) + prefix;
+		else if (!listed) {
+			std::cout << "\r\n";
+			for (const auto& candidate : candidates)
+				std::cout << candidate << "  ";
+			std::cout << "\r\n";
+			listed = true;
+		}
+		redraw(prompt, line);
+	}
+
+public:
+	/**
+	 * @brief				Constructor.
+	 * @param completer		Function that returns completion candidates.
+	 */
+	LineEditor(Completer completer) : completer{ std::move(completer) } {}
+
+	/**
+	 * @brief			Read a line of input.
+	 * @param prompt	The prompt, which has already been printed. It is reprinted when the line is redrawn.
+	 * @param line		Receives the line, excluding the newline.
+	 * @param running	Reading stops when this returns false, such as after an interrupt.
+	 * @returns			bool	false when the end of the input was reached, or reading was interrupted.
+	 */
+	template<std::invocable Predicate>
+	bool read(const std::string& prompt, std::string& line, Predicate&& running) const
+	{
+		line.clear();
+#		ifndef OS_WIN
+		if (::isatty(STDIN_FILENO) == 1) {
+			termios original{};
+			if (::tcgetattr(STDIN_FILENO, &original) == 0) {
+				termios raw{ original };
+				raw.c_lflag &= ~static_cast<tcflag_t>(ICANON | ECHO); // keep ISIG so Ctrl+C still raises SIGINT
+				raw.c_cc[VMIN] = 1;
+				raw.c_cc[VTIME] = 0;
+				::tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+				bool result{ false }, listed{ false };
+				for (char c; running(); ) {
+					if (const auto n{ ::read(STDIN_FILENO, &c, 1) }; n != 1) {
+						if (n == -1 && errno == EINTR)
+							continue;
+						break;
+					}
+
+					if (c == '\t') {
+						complete(prompt, line, listed);
+						continue;
+					}
+					listed = false;
+					if (c == '\n' || c == '\r') {
+						std::cout << '\n';
+						result = true;
+						break;
+					}
+					else if (c == 4) { // Ctrl+D
+						if (line.empty())
+							break;
+					}
+					else if (c == 127 || c == '\b') {
+						if (!line.empty()) {
+							// remove a whole UTF-8 character
+							do line.pop_back();
+							while (!line.empty() && (static_cast<unsigned char>(line.back()) & 0xC0u) == 0x80u);
+							redraw(prompt, line);
+						}
+					}
+					else if (c == 21) { // Ctrl+U
+						line.clear();
+						redraw(prompt, line);
+					}
+					else if (c == 23) { // Ctrl+W
+						while (!line.empty() && line.back() == ' ')
+							line.pop_back();
+						while (!line.empty() && line.back() != ' ')
+							line.pop_back();
+						redraw(prompt, line);
+					}
+					else if (c == '\x1b') { // discard escape sequences, such as arrow keys
+						char seq[2];
+						if (::read(STDIN_FILENO, &seq[0], 1) == 1 && seq[0] == '[')
+							while (::read(STDIN_FILENO, &seq[1], 1) == 1 && !(seq[1] >= '@' && seq[1] <= '~')) {}
+					}
+					else if (static_cast<unsigned char>(c) >= 0x20) {
+						line.push_back(c);
+						(std::cout << c).flush();
+					}
+				}
+				::tcsetattr(STDIN_FILENO, TCSANOW, &original);
+				return result;
+			}
+		}
+#		endif
+		(void)prompt;
+		return running() && static_cast<bool>(std::getline(std::cin, line));
+	}
+};
@@ -1,4 +1,14 @@
 #include "net/mode.hpp"		///< RCON client modes
+#include "net/replay.hpp"		///< recording playback mode
+#include "net/bench.hpp"		///< benchmark mode
+#include "net/load.hpp"		///< load generator mode
+#include "net/stripe.hpp"		///< striped commandline mode
+#include "net/lua-engine.hpp"	///< Lua scripting mode
+#include "net/fleet.hpp"		///< multi-host output file mode
+#include "net/multi.hpp"		///< multi-session mode
+#include "net/gateway.hpp"		///< HTTP/JSON gateway mode
+#include "net/serve.hpp"		///< stdio JSON-RPC server mode
+#include "net/schedule.hpp"		///< cron-style scheduler mode
 #include "utils.hpp"
 
 #include <make_exception.hpp>
@@ -22,6 +32,33 @@ int main(const int argc, char** argv)
 			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, 'f', "file"),
 			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "save-host"),
 			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "remove-host"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "record"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "replay"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "replay-speed"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "flight-dump"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "bench"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "concurrency"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "load"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "rate"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "duration"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "mix"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "stripe"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "checkpoint"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "template"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "csv"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "tsv"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "lua"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "grep"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "exclude"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "encoding"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "output-dir"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "shm"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "shm-size"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "gateway"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "pool-size"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "shards"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "schedule"),
+			opt3::make_template(opt3::CaptureStyle::Required, opt3::ConflictStyle::Conflict, "upgrade-socket"),
 		}; // parse arguments
 
 		// Argument:  [-n|--no-color]
@@ -47,6 +84,10 @@ int main(const int argc, char** argv)
 
 		const config::Locator cfg_path(myDir, myNameNoExt);
 
+		// Argument:  [--flight-dump]
+		net::flight::set_dump_path(args.getv<opt3::Option>("flight-dump").value_or(cfg_path.from_extension(".flight").string()));
+		net::flight::install_signal_handler();
+
 		// Argument:  [-q|--quiet]
 		Global.quiet = args.check_any<opt3::Option, opt3::Flag>('q', 's', "quiet");
 		// Argument:  [-h|--help]
@@ -74,6 +115,20 @@ int main(const int argc, char** argv)
 		if (file::exists(ini_path))
 			config::load_ini(ini_path);
 
+		// Argument:  [--replay]
+		if (const auto replay_file{ args.getv<opt3::Option>("replay") }; replay_file.has_value()) {
+			double speed{ 1.0 };
+			if (const auto arg{ args.getv<opt3::Option>("replay-speed") }; arg.has_value()) {
+				try {
+					speed = std::stod(arg.value());
+				} catch (...) {
+					throw make_exception("Invalid replay speed given: \"", arg.value(), "\", expected a number.");
+				}
+			}
+			mode::replay(replay_file.value(), args.getv_any<opt3::Flag, opt3::Option>('H', "host").value_or("127.0.0.1"), args.getv_any<opt3::Flag, opt3::Option>('P', "port").value_or(Global.DEFAULT_TARGET.port), speed);
+			return 0;
+		}
+
 		// Override with environment variables if specified
 		Global.target.hostname = Global.env.Values.hostname.value_or(Global.target.hostname);
 		Global.target.port = Global.env.Values.port.value_or(Global.target.port);
@@ -132,6 +187,17 @@ int main(const int argc, char** argv)
 		// scriptfiles:
 		for (const auto& scriptfile : args.getv_all<opt3::Option, opt3::Flag>('f', "file"))
 			Global.scriptfiles.emplace_back(scriptfile);
+		// response encoding:
+		if (const auto arg{ args.getv<opt3::Option>("encoding") }; arg.has_value()) {
+			if (const auto enc{ encoding::parse(arg.value()) }; enc.has_value())
+				Global.encoding = enc.value();
+			else throw make_exception("Invalid encoding given: \"", arg.value(), "\", expected \"utf8\", \"latin1\", \"cp1252\", or \"auto\".");
+		}
+		// response filters:
+		for (const auto& pattern : args.getv_all<opt3::Option>("grep"))
+			Global.filter.include(pattern);
+		for (const auto& pattern : args.getv_all<opt3::Option>("exclude"))
+			Global.filter.exclude(pattern);
 
 		handle_hostfile_arguments(args, hosts, hostfile_path);
 
@@ -142,10 +208,94 @@ int main(const int argc, char** argv)
 		if (Global.custom_prompt.empty())
 			Global.custom_prompt = (Global.no_prompt ? "" : str::stringify(Global.palette.set(Color::GREEN), "RCON@", Global.target.hostname, Global.palette.reset(Color::GREEN), '>', Global.palette.reset(), ' '));
 
+		// Argument:  [--shm]
+		if (const auto shm_name{ args.getv<opt3::Option>("shm") }; shm_name.has_value())
+			net::feed::feed.open(shm_name.value(), getv_count(args, "shm-size").value_or(net::feed::DEFAULT_CAPACITY / 1024ull) * 1024ull);
+
+		// Argument:  [--bench]
+		if (const auto bench_count{ getv_count(args, "bench") }; bench_count.has_value()) {
+			net::rcon::require_password(Global.target.hostname, Global.target.port, Global.target.password);
+			mode::bench(Global.target, commands, bench_count.value(), getv_count(args, "concurrency").value_or(4ull));
+			return 0;
+		}
+
+		// Argument:  [--load]
+		if (const auto load_sessions{ getv_count(args, "load") }; load_sessions.has_value()) {
+			net::rcon::require_password(Global.target.hostname, Global.target.port, Global.target.password);
+			std::vector<mode::WeightedCommand> mix;
+			if (const auto mix_file{ args.getv<opt3::Option>("mix") }; mix_file.has_value())
+				mix = mode::read_mix_file(mix_file.value());
+			for (const auto& command : commands)
+				mix.emplace_back(mode::WeightedCommand{ 1.0, command });
+
+			double rate{ 0.0 };
+			if (const auto arg{ args.getv<opt3::Option>("rate") }; arg.has_value()) {
+				try {
+					rate = std::stod(arg.value());
+				} catch (...) {
+					throw make_exception("Invalid rate given: \"", arg.value(), "\", expected a number of commands per second.");
+				}
+			}
+			mode::load(Global.target, mix, load_sessions.value(), rate, std::chrono::seconds{ getv_count(args, "duration").value_or(60ull) });
+			return 0;
+		}
+
+		// Argument:  [--stripe]
+		if (const auto stripes{ getv_count(args, "stripe") }; stripes.has_value() && !commands.empty()) {
+			if (args.check<opt3::Option>("checkpoint"))
+				throw make_exception("[--checkpoint] can't be used with [--stripe], because striped commands don't complete in order!");
+			net::rcon::require_password(Global.target.hostname, Global.target.port, Global.target.password);
+			mode::striped(Global.target, commands, stripes.value());
+			return 0;
+		}
+
+		// Argument:  [--output-dir]
+		if (const auto output_dir{ args.getv<opt3::Option>("output-dir") }; output_dir.has_value()) {
+			if (commands.empty())
+				throw make_exception("[--output-dir] requires at least one command!");
+			return mode::fleet(resolveSavedTargets(args, hosts, Global.target), commands, output_dir.value()) == 0ull ? 0 : 1;
+		}
+
+		// Argument:  [--gateway]
+		if (const auto port{ args.getv<opt3::Option>("gateway") }; port.has_value()) {
+			net::PoolRegistry pools{ getAllTargets(hosts, Global.target), getv_count(args, "pool-size").value_or(2ull), getv_count(args, "shards").value_or(0ull) };
+			const auto watcher{ watchConfig(ini_path, hostfile_path, [&pools](auto&& targets) { pools.update(std::move(targets)); }) };
+			mode::gateway(pools, port.value(), args.getv<opt3::Option>("upgrade-socket").value_or(""));
+			return 0;
+		}
+
+		// Argument:  [--serve-stdio]
+		if (args.check<opt3::Option>("serve-stdio")) {
+			mode::StdioServer server{ getAllTargets(hosts, Global.target) };
+			const auto watcher{ watchConfig(ini_path, hostfile_path, [&server](auto&& targets) { server.update(std::move(targets)); }) };
+			mode::serve_stdio(server);
+			return 0;
+		}
+
+		// Argument:  [--schedule]
+		if (const auto jobs_file{ args.getv<opt3::Option>("schedule") }; jobs_file.has_value()) {
+			net::PoolRegistry pools{ getAllTargets(hosts, Global.target), getv_count(args, "pool-size").value_or(2ull), getv_count(args, "shards").value_or(0ull) };
+			const auto watcher{ watchConfig(ini_path, hostfile_path, [&pools](auto&& targets) { pools.update(std::move(targets)); }) };
+			mode::schedule(pools, mode::read_jobs_file(jobs_file.value()));
+			return 0;
+		}
+
+		// Argument:  [-S|--saved] specified more than once
+		if (const auto targets{ resolveSavedTargets(args, hosts, Global.target) }; targets.size() > 1ull) {
+			mode::multi(targets, commands, commands.empty() || Global.force_interactive);
+			return 0;
+		}
+
 		// Register the cleanup function before connecting the socket
 		std::atexit(&net::cleanup);
 
+		// Argument:  [--record]
+		if (const auto record_file{ args.getv<opt3::Option>("record") }; record_file.has_value())
+			if (!net::record::recorder.open(record_file.value()))
+				throw permission_exception("main()", record_file.value(), "Failed to open recording file for writing!");
+
 		// Connect the socket
+		net::rcon::require_password(Global.target.hostname, Global.target.port, Global.target.password);
 		Global.socket = net::connect(Global.target.hostname, Global.target.port);
 
 		// set & check if the socket was connected successfully
@@ -153,29 +303,57 @@ int main(const int argc, char** argv)
 		if (!Global.connected)
 			throw connection_exception("main()", "Socket descriptor was set to (" + std::to_string(Global.socket) + ") after successfully initializing the connection.", Global.target.hostname, Global.target.port, LAST_SOCKET_ERROR_CODE(), net::getLastSocketErrorMessage());
 
-		if (!Global.allowBlankPassword && Global.target.password.empty())
-			throw make_exception("Password cannot be blank!");
-
 		// authenticate with the server
 		if (rcon::authenticate(Global.socket, Global.target.password)) {
 			// authentication succeeded, run queued commands, and open an interactive session if necessary.
-			const bool hasCommands = !commands.empty();
-			if (hasCommands)
-				mode::commandline(commands);
+			const auto command_template{ args.getv<opt3::Option>("template") };
+			const auto lua_script{ args.getv<opt3::Option>("lua") };
+			const bool hasCommands = !commands.empty() || command_template.has_value() || lua_script.has_value();
+			// Argument:  [--lua]; the commandline parameters are passed to the script instead of being sent
+			if (lua_script.has_value())
+				mode::lua(lua_script.value(), commands);
+			else if (!commands.empty()) {
+				// Argument:  [--checkpoint] & [--resume]
+				if (const auto checkpoint_file{ args.getv<opt3::Option>("checkpoint") }; checkpoint_file.has_value()) {
+					Checkpoint checkpoint{ checkpoint_file.value(), commands, args.check<opt3::Option>("resume") };
+					if (const auto skipped{ checkpoint.get_completed() }; skipped > 0ull && !Global.quiet)
+						std::cout << Global.palette.get_msg() << "Resuming from command " << skipped + 1ull << " of " << commands.size() << '\n';
+					const auto count{ mode::commandline(commands, &checkpoint) };
+					if (!Global.quiet)
+						std::cout << Global.palette.get_msg() << "Completed " << checkpoint.get_completed() << " of " << commands.size() << " commands (" << count << " received a response)." << std::endl;
+				}
+				else mode::commandline(commands);
+			}
+			// Argument:  [--template] with [--csv] or [--tsv]
+			if (command_template.has_value()) {
+				const auto csv_file{ args.getv<opt3::Option>("csv") }, tsv_file{ args.getv<opt3::Option>("tsv") };
+				if (csv_file.has_value() == tsv_file.has_value())
+					throw make_exception("[--template] requires exactly one input file, specified with [--csv] or [--tsv]!");
+				const auto& input_file{ csv_file.has_value() ? csv_file.value() : tsv_file.value() };
+				const char delim{ csv_file.has_value() ? ',' : '\t' };
+				if (input_file == "-")
+					mode::templated(command_template.value(), std::cin, delim);
+				else if (std::ifstream ifs{ input_file }; ifs.is_open())
+					mode::templated(command_template.value(), ifs, delim);
+				else throw make_exception("Failed to open template input file \"", input_file, "\"!");
+			}
 			if (!hasCommands || Global.force_interactive)
-				mode::interactive(Global.socket); // if no commands were executed from the commandline or if the force interactive flag was set
+				mode::interactive(Global.socket, cfg_path.from_extension('.' + net::CompletionCache::file_name(Global.target) + ".completions")); // if no commands were executed from the commandline or if the force interactive flag was set
 		}
 		else throw badpass_exception(Global.target.hostname, Global.target.port, LAST_SOCKET_ERROR_CODE(), net::getLastSocketErrorMessage());
 
 		return 0;
 	} catch (const ex::except& ex) { // custom exception type
+		net::flight::dump("fatal error");
 		std::cerr << Global.palette.get_fatal() << ex.what() << std::endl;
 		return 1;
 	} catch (const std::exception& ex) { // standard exceptions
+		net::flight::dump("fatal error");
 		std::cerr << Global.palette.get_fatal() << ex.what() << std::endl;
 		std::cerr << Global.palette.get_placeholder() << "Please report this exception here: " << ISSUE_REPORT_URL << std::endl;
 		return 1;
 	} catch (...) { // undefined exceptions
+		net::flight::dump("fatal error");
 		std::cerr << Global.palette.get_crit() << "An unknown exception occurred!" << std::endl;
 		return 1;
 	}
@@ -0,0 +1,259 @@
+/**
+ * @file	bench.hpp
+ * @author	radj307
+ * @brief	Contains the benchmark mode, which measures command throughput & latency against a live server.
+ */
+#pragma once
+#include "../globals.h"
+#include "session.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mode {
+	/**
+	 * @struct	Latencies
+	 * @brief	A set of latency samples that can be summarized as percentiles.
+	 */
+	struct Latencies {
+		std::vector<std::chrono::nanoseconds> samples;
+
+		/// @brief	Add a sample.
+		void add(const std::chrono::nanoseconds& sample) { samples.emplace_back(sample); }
+
+		/// @brief	Add all samples from another set.
+		void merge(const Latencies& o) { samples.insert(samples.end(), o.samples.begin(), o.samples.end()); }
+
+		/**
+		 * @brief		Get the sample at the given percentile using the nearest-rank method.
+		 *\n			The samples are sorted in-place the first time this is called.
+		 * @param p		Percentile in the range (0, 100].
+		 * @returns		std::chrono::nanoseconds
+		 */
+		std::chrono::nanoseconds percentile(const double& p)
+		{
+			if (samples.empty())
+				return std::chrono::nanoseconds{ 0 };
+			if (!std::is_sorted(samples.begin(), samples.end()))
+				std::sort(samples.begin(), samples.end());
+			const auto rank{ static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(samples.size()))) };
+			return samples[std::clamp(rank, static_cast<size_t>(1), samples.size()) - 1];
+		}
+
+		/// @brief	Print a one-line summary of the samples.
+		void print(std::ostream& os, const std::string& label)
+		{
+			const auto ms{ [](const std::chrono::nanoseconds& ns) { return std::chrono::duration<double, std::milli>(ns).count(); } };
+			os << "  " << std::left << std::setw(22) << label << std::right << std::fixed << std::setprecision(3)
+				<< " n=" << std::setw(7) << samples.size()
+				<< "  p50=" << std::setw(9) << ms(percentile(50)) << "ms"
+				<< "  p90=" << std::setw(9) << ms(percentile(90)) << "ms"
+				<< "  p99=" << std::setw(9) << ms(percentile(99)) << "ms"
+				<< "  max=" << std::setw(9) << ms(percentile(100)) << "ms" << '\n';
+		}
+	};
+
+	/**
+	 * @brief			Print the throughput of a benchmark run.
+	 * @param os		Output stream.
+	 * @param label		Name of the run.
+	 * @param count		Number of commands that were executed.
+	 * @param elapsed	Total wall-clock time of the run.
+	 */
+	inline void print_throughput(std::ostream& os, const std::string& label, const size_t& count, const std::chrono::nanoseconds& elapsed)
+	{
+		const double seconds{ std::chrono::duration<double>(elapsed).count() };
+		os << "  " << std::left << std::setw(22) << label << std::right << std::fixed << std::setprecision(3)
+			<< " " << count << " commands in " << seconds << "s  (" << std::setprecision(1) << (seconds > 0.0 ? static_cast<double>(count) / seconds : 0.0) << " cmd/s)\n";
+	}
+
+	/**
+	 * @brief				Benchmark a target server by running the given commands repeatedly.
+	 *\n					Runs are performed serially with rcon::command(), serially with rcon::exchange(),
+	 *\n					pipelined over a single connection, and in parallel over several connections.
+	 * @param target		The target server's connection information.
+	 * @param commands		Commands to run; these are cycled through until count commands have been sent.
+	 * @param count			Number of commands to run in each benchmark.
+	 * @param concurrency	Number of connections to use for the parallel benchmark.
+	 */
+	inline void bench(const net::HostInfo& target, const std::vector<std::string>& commands, const size_t& count, const size_t& concurrency)
+	{
+		using clock = std::chrono::steady_clock;
+		using namespace std::chrono_literals;
+
+		if (commands.empty())
+			throw make_exception("No commands were specified to benchmark!");
+		if (count == 0ull || concurrency == 0ull)
+			throw make_exception("The benchmark count & concurrency must be greater than 0!");
+
+		const auto ignore{ [](const net::packet::Packet&) {} };
+		const auto& cmd{ [&commands](const size_t& i) -> const std::string& { return commands[i % commands.size()]; } };
+
+		Latencies connect, auth;
+		size_t errors{ 0ull };
+
+		std::cout << "Benchmarking " << target.hostname << ':' << target.port << " with " << count << " commands";
+		if (commands.size() == 1ull)
+			std::cout << " (\"" << commands.front() << "\")";
+		std::cout << '\n' << std::endl;
+
+		// serial, using rcon::command()
+		{
+			net::Session session{ target };
+			connect.add(session.connect_time);
+			auth.add(session.auth_time);
+
+			Latencies latency;
+			const auto t0{ clock::now() };
+			for (size_t i{ 0ull }; i < count; ++i) {
+				const auto t{ clock::now() };
+				errors += static_cast<size_t>(!net::rcon::command(session.socket(), cmd(i), ignore));
+				latency.add(clock::now() - t);
+			}
+			print_throughput(std::cout, "serial (command)", count, clock::now() - t0);
+			latency.print(std::cout, "serial (command)");
+		}
+
+		// serial, using rcon::exchange()
+		{
+			net::Session session{ target };
+			connect.add(session.connect_time);
+			auth.add(session.auth_time);
+
+			Latencies latency;
+			const auto t0{ clock::now() };
+			for (size_t i{ 0ull }; i < count; ++i) {
+				const auto t{ clock::now() };
+				// sessions are closed when a command times out
+				if (!session.is_open())
+					session.open(target);
+				errors += static_cast<size_t>(!session.exchange(cmd(i), ignore));
+				latency.add(clock::now() - t);
+			}
+			print_throughput(std::cout, "serial (exchange)", count, clock::now() - t0);
+			latency.print(std::cout, "serial (exchange)");
+		}
+
+		// pipelined: every command is sent without waiting for the previous response
+		{
+			net::Session session{ target };
+			connect.add(session.connect_time);
+			auth.add(session.auth_time);
+
+			std::vector<int> ids(count);
+			std::unordered_map<int, size_t> index_of;
+			index_of.reserve(count);
+			for (size_t i{ 0ull }; i < count; ++i)
+				index_of.emplace(ids[i] = net::packet::ID_Manager.get(), i);
+			const int terminator_id{ net::packet::ID_Manager.get() };
+
+			const auto sent_at{ std::make_unique<std::atomic<clock::rep>[]>(count) };
+			std::vector<bool> seen(count, false);
+
+			Latencies latency;
+			const auto t0{ clock::now() };
+			std::thread sender{ [&]() {
+				for (size_t i{ 0ull }; i < count; ++i) {
+					sent_at[i].store(clock::now().time_since_epoch().count(), std::memory_order_release);
+					if (!net::send_packet(session.socket(), { ids[i], net::packet::Type::SERVERDATA_EXECCOMMAND, cmd(i) }))
+						break;
+				}
+				net::send_packet(session.socket(), { terminator_id, net::packet::Type::SERVERDATA_RESPONSE_VALUE, "TERM" });
+			} };
+
+			fd_set set;
+			bool failed{ false };
+			try {
+				for (;;) {
+					FD_ZERO(&set);
+					FD_SET(session.socket(), &set);
+					const auto timeout{ net::make_exact_timeout(10s) };
+					if (SELECT(session.socket() + 1ll, &set, nullptr, nullptr, &timeout) != 1) {
+						failed = true;
+						break;
+					}
+					const auto p{ net::recv_packet(session.socket()) };
+					if (p.id == terminator_id)
+						break;
+					if (const auto it{ index_of.find(p.id) }; it != index_of.end() && !seen[it->second]) {
+						seen[it->second] = true;
+						latency.add(clock::now() - clock::time_point{ clock::duration{ sent_at[it->second].load(std::memory_order_acquire) } });
+					}
+				}
+			} catch (const std::exception&) {
+				failed = true;
+			}
+			const auto elapsed{ clock::now() - t0 };
+			if (failed) {
+				// the sender may be blocked on a server that stopped reading
+			#ifdef OS_WIN
+				::shutdown(session.socket(), SD_BOTH);
+			#else
+				::shutdown(session.socket(), SHUT_RDWR);
+			#endif
+			}
+			sender.join();
+			// every command without a response is an error, including those lost when the run failed
+			errors += count - latency.samples.size();
+
+			print_throughput(std::cout, "pipelined", count, elapsed);
+			latency.print(std::cout, "pipelined");
+		}
+
+		// parallel: the commands are split between several connections
+		{
+			std::vector<net::Session> sessions;
+			sessions.reserve(concurrency);
+			for (size_t i{ 0ull }; i < concurrency; ++i) {
+				auto& session{ sessions.emplace_back(target) };
+				connect.add(session.connect_time);
+				auth.add(session.auth_time);
+			}
+
+			std::vector<Latencies> latencies(concurrency);
+			std::atomic<size_t> parallel_errors{ 0ull };
+			std::vector<std::thread> workers;
+			workers.reserve(concurrency);
+
+			const auto t0{ clock::now() };
+			for (size_t w{ 0ull }; w < concurrency; ++w) {
+				workers.emplace_back([&, w]() {
+					try {
+						for (size_t i{ w }; i < count; i += concurrency) {
+							const auto t{ clock::now() };
+							if (!sessions[w].is_open())
+								sessions[w].open(target);
+							parallel_errors += static_cast<size_t>(!sessions[w].exchange(cmd(i), ignore));
+							latencies[w].add(clock::now() - t);
+						}
+					} catch (const std::exception&) {
+						++parallel_errors;
+					}
+				});
+			}
+			for (auto& worker : workers)
+				worker.join();
+			const auto elapsed{ clock::now() - t0 };
+			errors += parallel_errors.load();
+
+			Latencies latency;
+			for (const auto& l : latencies)
+				latency.merge(l);
+
+			const std::string label{ "parallel (x" + std::to_string(concurrency) + ")" };
+			print_throughput(std::cout, label, count, elapsed);
+			latency.print(std::cout, label);
+		}
+
+		std::cout << '\n';
+		connect.print(std::cout, "connect");
+		auth.print(std::cout, "auth");
+		std::cout << "  errors:  " << errors << std::endl;
+	}
+}
@@ -0,0 +1,223 @@
+/**
+ * @file	completion.hpp
+ * @author	radj307
+ * @brief	Contains the completion cache used by interactive mode's tab completion.
+ *\n		Server commands & player names are fetched in the background over a separate session, using the "help" & "list"
+ *\n		commands, then cached on disk so that completion is available immediately the next time the host is used.
+ */
+#pragma once
+#include "../globals.h"
+#include "../filter.hpp"
+#include "session.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace net {
+	/**
+	 * @class	CompletionCache
+	 * @brief	Stores completion candidates for a single host & keeps them up to date from a background thread.
+	 */
+	class CompletionCache {
+		std::filesystem::path path;
+		HostInfo target;
+
+		mutable std::mutex mtx;
+		std::set<std::string> commands, players;
+
+		std::mutex wait_mtx;
+		std::condition_variable cv;
+		bool stop{ false };
+		std::thread thread;
+
+		/**
+		 * @brief		Parse the response to "help" into command names.
+		 *\n			The first word of each line is used. Lines that begin with '/' may list several commands, since
+		 *\n			some servers separate them with '/' instead of newlines; for example: "/ban <targets>/ban-ip <target>"
+		 */
+		static std::set<std::string> parse_help(const std::string& response)
+		{
+			std::set<std::string> names;
+			const auto add{ [&names](const std::string_view& entry) {
+				const auto begin{ entry.find_first_not_of(" \t/") };
+				if (begin == std::string_view::npos)
+					return;
+				const auto end{ entry.find_first_of(" \t:", begin) };
+				const auto name{ entry.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin) };
+				if (!name.empty() && std::all_of(name.begin(), name.end(), [](auto&& c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '.' || c == ':'; }))
+					names.emplace(name);
+			} };
+
+			std::string buffer;
+			filter::for_each_line(filter::strip_colors(response, buffer), [&add](const std::string_view& line) {
+				if (!line.starts_with('/')) {
+					add(line);
+					return;
+				}
+				size_t begin{ 0ull };
+				for (size_t i{ 1ull }; i < line.size(); ++i) {
+					if (line[i] == '/' && !std::isalnum(static_cast<unsigned char>(line[i - 1ull])) && i + 1ull < line.size() && std::isalpha(static_cast<unsigned char>(line[i + 1ull]))) {
+						add(line.substr(begin, i - begin));
+						begin = i;
+					}
+				}
+				add(line.substr(begin));
+			});
+			return names;
+		}
+
+		/**
+		 * @brief		Parse the response to "list" into player names.
+		 *\n			Names are read from the comma-separated list after the first ':'; for example:
+		 *\n			"There are 2 of a max of 20 players online: Alice, Bob"
+		 */
+		static std::set<std::string> parse_list(const std::string& response)
+		{
+			std::set<std::string> names;
+			std::string buffer;
+			const std::string text{ filter::strip_colors(response, buffer) };
+			const auto colon{ text.find(':') };
+			if (colon == std::string::npos)
+				return names;
+			std::stringstream ss{ text.substr(colon + 1ull) };
+			for (std::string name; std::getline(ss, name, ','); ) {
+				const auto begin{ name.find_first_not_of(" \t\r\n") }, end{ name.find_last_not_of(" \t\r\n") };
+				if (begin != std::string::npos)
+					names.emplace(name.substr(begin, end - begin + 1ull));
+			}
+			return names;
+		}
+
+		/// @brief	Fetch new candidates from the server over a separate session, then save them to disk.
+		void refresh()
+		{
+			Session session{ target };
+			std::string help, list;
+			session.exchange("help", [&help](const packet::Packet& p) { help += p.body; });
+			if (session.is_open())
+				session.exchange("list", [&list](const packet::Packet& p) { list += p.body; });
+			session.close();
+
+			std::string converted;
+			auto new_commands{ parse_help(std::string{ encoding::to_utf8(help, Global.encoding, converted) }) };
+			auto new_players{ parse_list(std::string{ encoding::to_utf8(list, Global.encoding, converted) }) };
+			{
+				std::scoped_lock lock(mtx);
+				if (!new_commands.empty())
+					commands = std::move(new_commands);
+				players = std::move(new_players);
+			}
+			save();
+		}
+
+		/// @brief	Background thread function.
+		void run(const std::chrono::seconds interval)
+		{
+			std::unique_lock lock(wait_mtx);
+			do {
+				lock.unlock();
+				try {
+					refresh();
+				} catch (...) {} // keep the cached candidates until the next refresh
+				lock.lock();
+			} while (!cv.wait_for(lock, interval, [this] { return stop; }));
+		}
+
+		/// @brief	Load candidates from the cache file, if it exists.
+		void load()
+		{
+			std::ifstream ifs{ path };
+			std::scoped_lock lock(mtx);
+			for (std::string ln; std::getline(ifs, ln); ) {
+				if (ln.size() < 3ull || ln[1] != ' ')
+					continue;
+				if (ln.front() == 'c')
+					commands.emplace(ln.substr(2ull));
+				else if (ln.front() == 'p')
+					players.emplace(ln.substr(2ull));
+			}
+		}
+
+		/// @brief	Save candidates to the cache file. Each line is "c <command>" or "p <player>".
+		void save() const
+		{
+			std::stringstream ss;
+			{
+				std::scoped_lock lock(mtx);
+				for (const auto& cmd : commands)
+					ss << "c " << cmd << '\n';
+				for (const auto& player : players)
+					ss << "p " << player << '\n';
+			}
+			std::error_code ec;
+			std::filesystem::create_directories(std::filesystem::path{ path }.remove_filename(), ec);
+			if (std::ofstream ofs{ path, std::ios_base::trunc }; ofs.is_open())
+				ofs << ss.rdbuf();
+		}
+
+	public:
+		/**
+		 * @brief			Load the cached candidates for a host & start refreshing them in the background.
+		 * @param path		Location of the cache file for this host.
+		 * @param target	The host's connection information. A separate session is opened for each refresh.
+		 * @param interval	Time between refreshes.
+		 */
+		CompletionCache(const std::filesystem::path& path, const HostInfo& target, const std::chrono::seconds& interval = std::chrono::minutes{ 5 }) : path{ path }, target{ target }
+		{
+			load();
+			thread = std::thread{ &CompletionCache::run, this, interval };
+		}
+		CompletionCache(const CompletionCache&) = delete;
+		CompletionCache& operator=(const CompletionCache&) = delete;
+		~CompletionCache()
+		{
+			{
+				std::scoped_lock lock(wait_mtx);
+				stop = true;
+			}
+			cv.notify_one();
+			if (thread.joinable())
+				thread.join();
+		}
+
+		/**
+		 * @brief			Get the completion candidates for a word.
+		 *\n				The first word of a line is completed with command names; other words are completed with player names.
+		 * @param word		The partial word.
+		 * @param index		The index of the word in the line.
+		 * @returns			std::vector<std::string>
+		 */
+		std::vector<std::string> complete(const std::string& word, const size_t& index) const
+		{
+			std::scoped_lock lock(mtx);
+			const auto& source{ index == 0ull ? commands : players };
+			std::vector<std::string> candidates;
+			for (auto it{ source.lower_bound(word) }; it != source.end() && it->starts_with(word); ++it)
+				candidates.emplace_back(*it);
+			return candidates;
+		}
+
+		/**
+		 * @brief			Get the cache file name for a host, with characters that aren't valid in file names replaced.
+		 * @param target	The host's connection information.
+		 * @returns			std::string	"<host>_<port>"
+		 */
+		static std::string file_name(const HostInfo& target)
+		{
+			auto name{ target.hostname + '_' + target.port };
+			std::replace_if(name.begin(), name.end(), [](auto&& c) { return !(std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '-' || c == '_'); }, '_');
+			return name;
+		}
+	};
+}
@@ -0,0 +1,271 @@
+/**
+ * @file	feed.hpp
+ * @author	radj307
+ * @brief	Contains the shared-memory response feed used by [--shm], which lets local programs read responses without parsing the terminal output.
+ *\n
+ *\n		The feed is a POSIX shared memory object ("/dev/shm/<name>" on Linux) laid out as follows.
+ *\n		All integers are little-endian, & every record begins on an 8-byte boundary.
+ *\n
+ *\n		  Offset  Size  Field
+ *\n		  0       8     magic         "ARRCSHM\0"
+ *\n		  8       4     version       2
+ *\n		  12      4     header_size   64; the data area begins at this offset
+ *\n		  16      8     capacity      size of the data area in bytes (a power of 2)
+ *\n		  24      8     write_pos     total number of bytes ever written to the data area (atomic; see below)
+ *\n		  32      8     sequence      number of records published (atomic)
+ *\n		  40      8     reserve_pos   end of the record that is being written; stored before any of its bytes (atomic)
+ *\n		  48      16    reserved
+ *\n
+ *\n		Records are written to the data area at (position % capacity):
+ *\n		  0       4     size          size of the record including this header & padding
+ *\n		  4       4     type          0 = response record, 1 = padding until the end of the data area (skip it;
+ *\n		                              only the size & type fields are valid)
+ *\n		  8       8     sequence      sequence number of this record, starting at 1
+ *\n		  16      8     timestamp     time the response was received, in nanoseconds since the UNIX epoch
+ *\n		  24      4     host_len      length of the host name
+ *\n		  28      4     command_len   length of the command
+ *\n		  32      4     body_len      length of the response body (UTF-8 without color codes)
+ *\n		  36      4     reserved
+ *\n		  40      ...   host, command & body, followed by padding to a multiple of 8 bytes
+ *\n
+ *\n		There is a single writer that never waits for readers. For each record, it stores the record's end in
+ *\n		reserve_pos followed by a release fence, copies the record into the data area, & then stores the new
+ *\n		write_pos with release semantics. Bytes before (reserve_pos - capacity) may be overwritten at any time.
+ *\n		Readers keep their own position:
+ *\n		  1. Load write_pos (acquire). If it's more than capacity bytes ahead, the reader fell behind & should
+ *\n		     skip forward to write_pos.
+ *\n		  2. Copy records from their position up to write_pos.
+ *\n		  3. Issue an acquire fence, then load reserve_pos. Any copied record that started before
+ *\n		     (reserve_pos - capacity) may have been overwritten while it was being copied, & must be discarded.
+ *\n		Checking against write_pos instead of reserve_pos in step 3 isn't enough, since the writer may be copying
+ *\n		a record past write_pos while the reader copies.
+ */
+#pragma once
+#include <sysarch.h>
+#include <make_exception.hpp>
+#include "../globals.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#ifndef OS_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace net::feed {
+	/// @brief	Magic bytes at the start of the shared memory object.
+	inline constexpr const char MAGIC[8]{ 'A', 'R', 'R', 'C', 'S', 'H', 'M', '\0' };
+	/// @brief	The version of the layout described in feed.hpp.
+	inline constexpr const uint32_t VERSION{ 2u };
+	/// @brief	The default size of the data area.
+	inline constexpr const uint64_t DEFAULT_CAPACITY{ 4ull * 1024ull * 1024ull };
+
+	/// @brief	The record types.
+	enum class RecordType : uint32_t {
+		RESPONSE = 0u,
+		PADDING = 1u,
+	};
+
+	/**
+	 * @struct	Header
+	 * @brief	The header at the start of the shared memory object.
+	 */
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t header_size;
+		uint64_t capacity;
+		std::atomic<uint64_t> write_pos;
+		std::atomic<uint64_t> sequence;
+		std::atomic<uint64_t> reserve_pos;
+		char reserved[16];
+	};
+	static_assert(sizeof(Header) == 64ull, "The feed header layout must match the documentation in feed.hpp!");
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "The feed requires lock-free 64-bit atomics!");
+
+	/**
+	 * @struct	RecordHeader
+	 * @brief	The header at the start of each record.
+	 */
+	struct RecordHeader {
+		uint32_t size;
+		RecordType type;
+		uint64_t sequence;
+		uint64_t timestamp;
+		uint32_t host_len;
+		uint32_t command_len;
+		uint32_t body_len;
+		uint32_t reserved;
+	};
+	static_assert(sizeof(RecordHeader) == 40ull, "The feed record layout must match the documentation in feed.hpp!");
+
+	/**
+	 * @class	Feed
+	 * @brief	Publishes responses to a shared memory ring buffer.
+	 */
+	class Feed {
+		std::string name;
+		Header* header{ nullptr };
+		char* data{ nullptr };
+		size_t mapped_size{ 0ull };
+		std::mutex mtx;
+
+		/// @brief	Copy bytes into the data area at the given position. The range must not wrap.
+		void copy(uint64_t& pos, const std::string_view& bytes)
+		{
+			std::memcpy(data + (pos & (header->capacity - 1ull)), bytes.data(), bytes.size());
+			pos += bytes.size();
+		}
+
+	public:
+		Feed() = default;
+		Feed(const Feed&) = delete;
+		Feed& operator=(const Feed&) = delete;
+		~Feed() { close(); }
+
+		/**
+		 * @brief			Create (or replace) the shared memory object & begin publishing to it.
+		 * @param shm_name	Name of the shared memory object. A leading '/' is added if it's missing.
+		 * @param capacity	Size of the data area, rounded up to a power of 2.
+		 * @throws except	The shared memory object couldn't be created, or shared memory isn't supported on this platform.
+		 */
+		void open(const std::string& shm_name, uint64_t capacity = DEFAULT_CAPACITY)
+		{
+#			ifdef OS_WIN
+			(void)shm_name;
+			(void)capacity;
+			throw make_exception("[--shm] isn't supported on Windows!");
+#			else
+			close();
+			name = shm_name.starts_with('/') ? shm_name : '/' + shm_name;
+			uint64_t size{ 4096ull };
+			while (size < capacity)
+				size <<= 1;
+			capacity = size;
+
+			const int fd{ ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) };
+			if (fd == -1)
+				throw make_exception("Failed to create shared memory object \"", name, "\": ", std::strerror(errno));
+			mapped_size = sizeof(Header) + capacity;
+			if (::ftruncate(fd, static_cast<off_t>(mapped_size)) != 0) {
+				::close(fd);
+				throw make_exception("Failed to resize shared memory object \"", name, "\": ", std::strerror(errno));
+			}
+			void* mem{ ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+			::close(fd);
+			if (mem == MAP_FAILED)
+				throw make_exception("Failed to map shared memory object \"", name, "\": ", std::strerror(errno));
+
+			header = new (mem) Header{};
+			std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+			header->version = VERSION;
+			header->header_size = static_cast<uint32_t>(sizeof(Header));
+			header->capacity = capacity;
+			header->write_pos.store(0ull, std::memory_order_release);
+			header->sequence.store(0ull, std::memory_order_release);
+			header->reserve_pos.store(0ull, std::memory_order_release);
+			data = static_cast<char*>(mem) + sizeof(Header);
+#			endif
+		}
+
+		/// @brief	Unmap & remove the shared memory object.
+		void close()
+		{
+#			ifndef OS_WIN
+			if (header != nullptr) {
+				::munmap(header, mapped_size);
+				::shm_unlink(name.c_str());
+				header = nullptr;
+				data = nullptr;
+			}
+#			endif
+		}
+
+		/// @brief	Check if the feed is open.
+		bool is_open() const { return header != nullptr; }
+
+		/**
+		 * @brief			Publish a response. Does nothing when the feed isn't open.
+		 *\n				This never waits for readers; old records are overwritten when the data area is full.
+		 *\n				Bodies that don't fit in the data area are truncated.
+		 * @param host		Name of the host that sent the response.
+		 * @param command	The command that was sent.
+		 * @param body		The response body.
+		 */
+		void publish(const std::string_view& host, const std::string_view& command, std::string_view body)
+		{
+			if (!is_open())
+				return;
+			const auto timestamp{ static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()) };
+
+			std::scoped_lock lock(mtx);
+			const auto capacity{ header->capacity };
+			const auto fixed{ sizeof(RecordHeader) + host.size() + command.size() };
+			if (fixed + 8ull > capacity / 2ull)
+				return; // the host & command alone don't fit
+			if (fixed + body.size() > capacity / 2ull)
+				body = body.substr(0ull, capacity / 2ull - fixed);
+			const auto size{ (fixed + body.size() + 7ull) & ~7ull };
+
+			auto pos{ header->write_pos.load(std::memory_order_relaxed) };
+			const auto remaining{ capacity - (pos & (capacity - 1ull)) };
+			// tell readers which bytes are about to be overwritten, before any of them are
+			header->reserve_pos.store(pos + (remaining < size ? remaining : 0ull) + size, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			if (remaining < size) {
+				// the record would wrap, so pad to the end of the data area
+				RecordHeader padding{};
+				padding.size = static_cast<uint32_t>(remaining);
+				padding.type = RecordType::PADDING;
+				if (remaining >= sizeof(RecordHeader))
+					std::memcpy(data + (pos & (capacity - 1ull)), &padding, sizeof(padding));
+				else std::memcpy(data + (pos & (capacity - 1ull)), &padding, remaining);
+				pos += remaining;
+			}
+
+			RecordHeader rh{};
+			rh.size = static_cast<uint32_t>(size);
+			rh.type = RecordType::RESPONSE;
+			rh.sequence = header->sequence.load(std::memory_order_relaxed) + 1ull;
+			rh.timestamp = timestamp;
+			rh.host_len = static_cast<uint32_t>(host.size());
+			rh.command_len = static_cast<uint32_t>(command.size());
+			rh.body_len = static_cast<uint32_t>(body.size());
+
+			const auto begin{ pos };
+			copy(pos, { reinterpret_cast<const char*>(&rh), sizeof(rh) });
+			copy(pos, host);
+			copy(pos, command);
+			copy(pos, body);
+
+			header->sequence.store(rh.sequence, std::memory_order_release);
+			header->write_pos.store(begin + size, std::memory_order_release);
+		}
+
+		/**
+		 * @brief			Publish a response as it was received, after converting it to UTF-8 & removing color codes.
+		 *\n				Does nothing when the feed isn't open.
+		 * @param host		Name of the host that sent the response.
+		 * @param command	The command that was sent.
+		 * @param response	The concatenated bodies of every response packet.
+		 */
+		void publish_response(const std::string_view& host, const std::string_view& command, const std::string_view& response)
+		{
+			if (!is_open())
+				return;
+			thread_local std::string converted, stripped;
+			publish(host, command, filter::strip_colors(encoding::to_utf8(response, Global.encoding, converted), stripped));
+		}
+	};
+
+	/// @brief	The feed used by [--shm].
+	inline Feed feed;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file	fleet.hpp
+ * @author	radj307
+ * @brief	Contains the fleet mode, which runs the same commands on several hosts at once & writes each host's responses to its own file.
+ */
+#pragma once
+#include "../globals.h"
+#include "../script.hpp"
+#include "../writer.hpp"
+#include "session.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mode {
+	/**
+	 * @brief				Execute a list of commands on several targets concurrently, writing the responses from each target to
+	 *\n					"<output_dir>/<name>.log". Files are written by a background thread, so a slow disk never delays the connections.
+	 *\n					"@grep" & "@exclude" directives are applied; other directives are ignored.
+	 * @param targets		Pairs of target names & connection information.
+	 * @param commands		List of commands & directives to execute on every target.
+	 * @param output_dir	Directory to write the output files to. It is created if it doesn't exist.
+	 * @returns				size_t	Number of targets that failed to connect, didn't respond to every command, or whose output file couldn't be written.
+	 */
+	inline size_t fleet(const std::vector<std::pair<std::string, net::HostInfo>>& targets, const std::vector<std::string>& commands, const std::filesystem::path& output_dir)
+	{
+		std::filesystem::create_directories(output_dir);
+
+		AsyncWriter writer;
+		std::vector<size_t> file_ids;
+		file_ids.reserve(targets.size());
+		for (const auto& [name, _] : targets)
+			file_ids.emplace_back(writer.open(output_dir / (name + ".log")));
+		writer.start();
+
+		std::mutex status_mtx;
+		std::atomic<size_t> failures{ 0ull };
+		const auto report{ [&status_mtx](const std::string& name, auto&&... message) {
+			if (Global.quiet)
+				return;
+			std::scoped_lock lock(status_mtx);
+			std::cerr << Global.palette(Color::YELLOW) << name << Global.palette() << ": ";
+			(std::cerr << ... << message) << '\n';
+		} };
+
+		std::vector<std::thread> workers;
+		workers.reserve(targets.size());
+		for (size_t t{ 0ull }; t < targets.size(); ++t) {
+			workers.emplace_back([&, t]() {
+				const auto& [name, target] { targets[t] };
+				const auto file{ file_ids[t] };
+				try {
+					net::Session session{ target };
+
+					size_t count{ 0ull }, total{ 0ull };
+					std::string buffer, response;
+					filter::Filter local;
+					for (const auto& line : commands) {
+						if (const auto directive{ script::parse_directive(line) }; directive.has_value()) {
+							if (directive->name == script::directive::GREP)
+								local.include(directive->args);
+							else if (directive->name == script::directive::EXCLUDE)
+								local.exclude(directive->args);
+							continue;
+						}
+						const auto cmd{ script::unescape(line) };
+						++total;
+						buffer.clear();
+						if (!Global.no_prompt)
+							buffer.append("> ").append(cmd).push_back('\n');
+						response.clear();
+						if (!session.is_open())
+							session.open(target);
+						if (session.exchange(cmd, [&buffer, &response, &local](const net::packet::Packet& p) {
+							append_plain(buffer, p, &local);
+							if (net::feed::feed.is_open())
+								response += p.body;
+						}))
+							++count;
+						else buffer += "[no response]\n";
+						net::feed::feed.publish_response(name, cmd, response);
+						writer.write(file, buffer);
+						local.clear();
+						std::this_thread::sleep_for(Global.command_delay.load());
+					}
+
+					if (count != total)
+						++failures;
+					report(name, count, " of ", total, " commands received a response.");
+				} catch (const std::exception& ex) {
+					++failures;
+					writer.write(file, std::string{ "[error] " } + ex.what() + '\n');
+					report(name, Global.palette.get_error(), ex.what());
+				}
+			});
+		}
+		for (auto& worker : workers)
+			worker.join();
+
+		for (const auto& error : writer.close()) {
+			++failures;
+			if (!Global.quiet)
+				std::cerr << Global.palette.get_error() << error << '\n';
+		}
+		return failures.load();
+	}
+}
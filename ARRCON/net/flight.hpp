@@ -0,0 +1,287 @@
+/**
+ * @file	flight.hpp
+ * @author	radj307
+ * @brief	Contains the flight recorder, an always-on ring buffer of recent networking events
+ *\n		that is written to disk when something goes wrong.
+ */
+#pragma once
+#include <sysarch.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+ /**
+  * @namespace	flight
+  * @brief		Contains the flight recorder's ring buffer & dump functions.
+  */
+namespace net::flight {
+	/**
+	 * @enum	Event
+	 * @brief	The types of events tracked by the flight recorder.
+	 */
+	enum class Event : uint8_t {
+		CONNECT,
+		AUTH,
+		SEND,
+		RECV,
+		SELECT,
+		BAD_SIZE,
+		TIMEOUT,
+		SOCKET_FAILURE,
+	};
+
+	/// @brief	Get the name of the given event, as it appears in dumps.
+	inline constexpr const char* to_string(const Event& ev) noexcept
+	{
+		switch (ev) {
+		case Event::CONNECT: return "connect";
+		case Event::AUTH: return "auth";
+		case Event::SEND: return "send";
+		case Event::RECV: return "recv";
+		case Event::SELECT: return "select";
+		case Event::BAD_SIZE: return "bad-size";
+		case Event::TIMEOUT: return "timeout";
+		case Event::SOCKET_FAILURE: return "socket-error";
+		default: return "unknown";
+		}
+	}
+
+	/**
+	 * @struct	Entry
+	 * @brief	A single flight recorder entry.
+	 */
+	struct Entry {
+		/// @brief	Monotonic timestamp in nanoseconds.
+		int64_t timestamp;
+		/// @brief	Packet ID, when applicable.
+		int32_t id;
+		/// @brief	Packet size, when applicable.
+		int32_t size;
+		/// @brief	Event-specific value; the select() return value, socket descriptor, or error code.
+		int32_t value;
+		Event event;
+	};
+
+	/**
+	 * @class	Ring
+	 * @brief	Fixed-size ring buffer that overwrites the oldest entry when full.
+	 * @tparam N	The number of entries to keep.
+	 */
+	template<size_t N>
+	class Ring {
+		/**
+		 * @struct	Slot
+		 * @brief	Storage for a single entry that can be written & read concurrently.
+		 *\n		The sequence number is the entry's position in the ring plus 1, or 0 while it is being written;
+		 *\n		readers skip entries whose sequence number changed while they were being read.
+		 */
+		struct Slot {
+			std::atomic<uint64_t> sequence{ 0ull };
+			std::atomic<int64_t> timestamp{ 0 };
+			std::atomic<int32_t> id{ 0 }, size{ 0 }, value{ 0 };
+			std::atomic<Event> event{};
+		};
+
+		std::array<Slot, N> slots{};
+		std::atomic<uint64_t> head{ 0ull };
+
+		/// @brief	Append the decimal representation of a number to a buffer.
+		static char* append(char* p, int64_t n) noexcept
+		{
+			if (n < 0) {
+				*p++ = '-';
+				n = -n;
+			}
+			char tmp[20];
+			int len{ 0 };
+			do {
+				tmp[len++] = static_cast<char>('0' + (n % 10));
+				n /= 10;
+			} while (n > 0);
+			while (len > 0)
+				*p++ = tmp[--len];
+			return p;
+		}
+		/// @brief	Append a null-terminated string to a buffer.
+		static char* append(char* p, const char* s) noexcept
+		{
+			while (*s != '\0')
+				*p++ = *s++;
+			return p;
+		}
+
+	public:
+		/**
+		 * @brief		Record an event. This is lock-free, and cheap enough to leave enabled at all times.
+		 *\n			Any thread may record events concurrently.
+		 * @param ev	The event type.
+		 * @param id	Packet ID.
+		 * @param size	Packet size.
+		 * @param value	Event-specific value.
+		 */
+		void push(const Event& ev, const int32_t& id = 0, const int32_t& size = 0, const int32_t& value = 0) noexcept
+		{
+			const auto i{ head.fetch_add(1ull, std::memory_order_relaxed) };
+			auto& slot{ slots[i % N] };
+			slot.sequence.store(0ull, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.timestamp.store(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+			slot.id.store(id, std::memory_order_relaxed);
+			slot.size.store(size, std::memory_order_relaxed);
+			slot.value.store(value, std::memory_order_relaxed);
+			slot.event.store(ev, std::memory_order_relaxed);
+			slot.sequence.store(i + 1ull, std::memory_order_release);
+		}
+
+		/**
+		 * @brief		Read the entry at the given position in the ring.
+		 * @param i		The entry's position.
+		 * @param out	Receives the entry.
+		 * @returns		true when the entry was read; false when it was overwritten or is still being written.
+		 */
+		bool read(const uint64_t& i, Entry& out) const noexcept
+		{
+			const auto& slot{ slots[i % N] };
+			if (slot.sequence.load(std::memory_order_acquire) != i + 1ull)
+				return false;
+			out.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+			out.id = slot.id.load(std::memory_order_relaxed);
+			out.size = slot.size.load(std::memory_order_relaxed);
+			out.value = slot.value.load(std::memory_order_relaxed);
+			out.event = slot.event.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return slot.sequence.load(std::memory_order_relaxed) == i + 1ull;
+		}
+
+		/**
+		 * @brief			Write all entries to a file descriptor, oldest first.
+		 *\n				Only async-signal-safe functions are used, so this can be called from a signal handler.
+		 * @param fd		Target file descriptor.
+		 * @param reason	A short description of why the dump was triggered.
+		 * @param skipped	Number of earlier dumps that were skipped by the rate limit, which is noted in the header.
+		 */
+		void dump(const int& fd, const char* reason, const uint32_t& skipped = 0u) const noexcept
+		{
+			char buf[160];
+			char* p{ append(append(buf, "=== ARRCON flight recorder dump: "), reason) };
+			if (skipped != 0u)
+				p = append(append(append(p, " ("), skipped), " earlier dumps skipped)");
+			p = append(p, " ===\n");
+			(void)!::write(fd, buf, static_cast<size_t>(p - buf));
+
+			const uint64_t end{ head.load(std::memory_order_relaxed) };
+			Entry e;
+			for (uint64_t i{ end > N ? end - N : 0ull }; i < end; ++i) {
+				if (!read(i, e))
+					continue;
+				p = append(buf, e.timestamp);
+				p = append(append(p, " "), to_string(e.event));
+				p = append(append(p, " id="), e.id);
+				p = append(append(p, " size="), e.size);
+				p = append(append(p, " value="), e.value);
+				*p++ = '\n';
+				(void)!::write(fd, buf, static_cast<size_t>(p - buf));
+			}
+		}
+	};
+
+	/// @brief	The flight recorder's ring buffer.
+	inline Ring<512> ring;
+
+	/// @brief	Location of the dump file. Stored as a fixed buffer so that it can be used by signal handlers.
+	inline char dump_path[4096]{};
+
+	/// @brief	Minimum time between dumps triggered by errors. Errors in between are still recorded, & appear in the next dump.
+	inline constexpr const std::chrono::seconds DUMP_INTERVAL{ 10 };
+	/// @brief	Size at which the dump file is renamed to "<file>.1", replacing the previous one, so at most about twice this is kept.
+	inline constexpr const off_t MAX_DUMP_FILE_SIZE{ 4 << 20 };
+
+	/// @brief	Time of the last dump triggered by an error, in steady clock nanoseconds, or 0.
+	inline std::atomic<int64_t> last_dump{ 0 };
+	/// @brief	Number of dumps that were skipped by the rate limit since the last dump.
+	inline std::atomic<uint32_t> skipped_dumps{ 0u };
+
+	/**
+	 * @brief		Set the location that the flight recorder is dumped to.
+	 * @param path	Target file path. Dumps are appended to this file.
+	 */
+	inline void set_dump_path(const std::filesystem::path& path)
+	{
+		const auto s{ path.string() };
+		const auto len{ std::min(s.size(), sizeof(dump_path) - 1) };
+		memcpy(dump_path, s.c_str(), len);
+		dump_path[len] = '\0';
+	}
+
+	/**
+	 * @brief			Append the contents of the flight recorder to the dump file, if one was set.
+	 * @param reason	A short description of why the dump was triggered.
+	 */
+	inline void dump(const char* reason) noexcept
+	{
+		if (dump_path[0] == '\0')
+			return;
+		int fd{ ::open(dump_path, O_WRONLY | O_CREAT | O_APPEND, 0644) };
+		if (fd != -1 && ::lseek(fd, 0, SEEK_END) >= MAX_DUMP_FILE_SIZE) {
+			// rotate the file, keeping the previous one
+			::close(fd);
+			char rotated[sizeof(dump_path) + 2];
+			const auto len{ strlen(dump_path) };
+			memcpy(rotated, dump_path, len);
+			memcpy(rotated + len, ".1", 3);
+			::rename(dump_path, rotated);
+			fd = ::open(dump_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+		}
+		if (fd != -1) {
+			ring.dump(fd, reason, skipped_dumps.exchange(0u));
+			::close(fd);
+		}
+	}
+
+	/**
+	 * @brief		Record an event, then dump the flight recorder unless another error triggered a dump within DUMP_INTERVAL.
+	 * @param ev	The event that triggered the dump.
+	 * @param id	Packet ID.
+	 * @param size	Packet size.
+	 * @param value	Event-specific value.
+	 */
+	inline void record_and_dump(const Event& ev, const int32_t& id = 0, const int32_t& size = 0, const int32_t& value = 0) noexcept
+	{
+		ring.push(ev, id, size, value);
+		const int64_t now{ std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() };
+		auto last{ last_dump.load(std::memory_order_relaxed) };
+		if ((last != 0 && now - last < std::chrono::duration_cast<std::chrono::nanoseconds>(DUMP_INTERVAL).count()) || !last_dump.compare_exchange_strong(last, now)) {
+			++skipped_dumps;
+			return;
+		}
+		dump(to_string(ev));
+	}
+
+#	ifndef OS_WIN
+	/// @brief	SIGQUIT handler that dumps the flight recorder without terminating the program.
+	inline void sigquit_handler(int) noexcept
+	{
+		dump("SIGQUIT");
+	}
+
+	/// @brief	Install the SIGQUIT handler.
+	inline void install_signal_handler()
+	{
+		struct sigaction action {};
+		action.sa_handler = sigquit_handler;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = SA_RESTART;
+		sigaction(SIGQUIT, &action, nullptr);
+	}
+#	else
+	inline void install_signal_handler() {}
+#	endif
+}
@@ -0,0 +1,455 @@
+/**
+ * @file	gateway.hpp
+ * @author	radj307
+ * @brief	Contains the gateway mode, which serves a small HTTP/JSON API on localhost backed by pooled RCON sessions.
+ *\n
+ *\n		Endpoints:
+ *\n		  GET  /hosts						List the names of every host.
+ *\n		  GET  /hosts/<name>/status			Get the state of a host's connection pool.
+ *\n		  POST /hosts/<name>/command		Execute {"command":"<command>"} & return the response.
+ *\n											Append "?priority=high" or "?priority=low" to choose the command's lane.
+ *\n
+ *\n		Since the gateway can execute commands with every saved password, requests that a web browser could have sent
+ *\n		on behalf of a web page are rejected: requests with an Origin header, requests whose Host isn't 127.0.0.1 or
+ *\n		localhost (DNS rebinding), & commands whose Content-Type isn't application/json, which browsers can't send
+ *\n		cross-origin without a preflight request that the gateway never approves.
+ */
+#pragma once
+#include "../globals.h"
+#include "../json.hpp"
+#include "handoff.hpp"
+#include "pool.hpp"
+#include "mode.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace net::http {
+	/// @brief	Maximum size of a request's headers.
+	inline constexpr const size_t MAX_HEADER_SIZE{ 64ull * 1024ull };
+	/// @brief	Maximum size of a request's body.
+	inline constexpr const size_t MAX_BODY_SIZE{ 1024ull * 1024ull };
+	/// @brief	Connections that don't send anything for this long are closed.
+	inline constexpr const std::chrono::seconds CLIENT_TIMEOUT{ 60 };
+
+	/**
+	 * @struct	Request
+	 * @brief	A parsed HTTP request.
+	 */
+	struct Request {
+		std::string method, path, body;
+		/// @brief	Values of the Host & Content-Type headers.
+		std::string host, content_type;
+		/// @brief	true when the request has an Origin header.
+		bool has_origin{ false };
+		bool keep_alive{ true };
+	};
+
+	/**
+	 * @struct	Response
+	 * @brief	An HTTP response with a JSON body.
+	 */
+	struct Response {
+		int status{ 200 };
+		std::string body;
+
+		/// @brief	Create an error response with a JSON body of the form {"error":"<message>"}.
+		static Response error(const int& status, const std::string_view& message)
+		{
+			return{ status, json::Object{}.add("error", message).str() };
+		}
+	};
+
+	/// @brief	Get the reason phrase for a status code.
+	inline constexpr const char* reason(const int& status)
+	{
+		switch (status) {
+		case 200:
+			return "OK";
+		case 400:
+			return "Bad Request";
+		case 404:
+			return "Not Found";
+		case 403:
+			return "Forbidden";
+		case 405:
+			return "Method Not Allowed";
+		case 413:
+			return "Payload Too Large";
+		case 415:
+			return "Unsupported Media Type";
+		case 502:
+			return "Bad Gateway";
+		default:
+			return "Internal Server Error";
+		}
+	}
+
+	/**
+	 * @class	Connection
+	 * @brief	Reads requests from & writes responses to a client socket.
+	 */
+	class Connection {
+		SOCKET sd;
+		std::string buffer;
+
+		/// @brief	Receive more data into the buffer. Returns false when the connection was closed.
+		bool fill()
+		{
+			char chunk[4096];
+			const auto n{ ::recv(sd, chunk, sizeof(chunk), 0) };
+			if (n <= 0)
+				return false;
+			buffer.append(chunk, static_cast<size_t>(n));
+			return true;
+		}
+
+	public:
+		/**
+		 * @brief		Constructor.
+		 * @param sd	The client's socket. Receives time out after CLIENT_TIMEOUT, so a silent client can't hold a thread forever.
+		 */
+		Connection(const SOCKET& sd) : sd{ sd }
+		{
+		#ifdef OS_WIN
+			const DWORD timeout{ static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(CLIENT_TIMEOUT).count()) };
+			setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+		#else
+			const timeval timeout{ static_cast<time_t>(CLIENT_TIMEOUT.count()), 0 };
+			setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		#endif
+		}
+		Connection(const Connection&) = delete;
+		Connection& operator=(const Connection&) = delete;
+		~Connection() { close_socket(sd); }
+
+		/**
+		 * @brief			Read the next request.
+		 * @param request	Receives the request.
+		 * @returns			int	0 when a request was read, -1 when the connection was closed, or an HTTP status code for malformed requests.
+		 */
+		int read(Request& request)
+		{
+			size_t header_end;
+			while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+				if (buffer.size() > MAX_HEADER_SIZE)
+					return 413;
+				if (!fill())
+					return -1;
+			}
+
+			std::stringstream ss{ buffer.substr(0ull, header_end) };
+			std::string version;
+			request = {};
+			if (!(ss >> request.method >> request.path >> version))
+				return 400;
+			request.keep_alive = version != "HTTP/1.0";
+
+			size_t content_length{ 0ull };
+			ss.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+			for (std::string ln; std::getline(ss, ln); ) {
+				if (!ln.empty() && ln.back() == '\r')
+					ln.pop_back();
+				const auto colon{ ln.find(':') };
+				if (colon == std::string::npos)
+					continue;
+				auto name{ ln.substr(0ull, colon) };
+				std::transform(name.begin(), name.end(), name.begin(), [](auto&& c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+				const auto value{ str::strip_line(ln.substr(colon + 1ull)) };
+				if (name == "content-length") {
+					const auto [end, ec] { std::from_chars(value.data(), value.data() + value.size(), content_length) };
+					if (ec == std::errc::result_out_of_range)
+						return 413;
+					if (value.empty() || ec != std::errc{} || end != value.data() + value.size())
+						return 400;
+				}
+				else if (name == "connection")
+					request.keep_alive = value != "close";
+				else if (name == "host")
+					request.host = value;
+				else if (name == "content-type") {
+					request.content_type = value;
+					std::transform(request.content_type.begin(), request.content_type.end(), request.content_type.begin(), [](auto&& c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+				}
+				else if (name == "origin")
+					request.has_origin = true;
+			}
+			if (content_length > MAX_BODY_SIZE)
+				return 413;
+
+			const auto body_begin{ header_end + 4ull };
+			while (buffer.size() < body_begin + content_length)
+				if (!fill())
+					return -1;
+			request.body = buffer.substr(body_begin, content_length);
+			buffer.erase(0ull, body_begin + content_length);
+			return 0;
+		}
+
+		/**
+		 * @brief			Send a response.
+		 * @param response	The response to send.
+		 * @param keep_alive	When false, the client is told that the connection will be closed.
+		 * @returns			bool	false when the response couldn't be sent.
+		 */
+		bool write(const Response& response, const bool& keep_alive)
+		{
+			const auto data{ str::stringify(
+				"HTTP/1.1 ", response.status, ' ', reason(response.status), "\r\n",
+				"Content-Type: application/json\r\n",
+				"Content-Length: ", response.body.size(), "\r\n",
+				"Connection: ", keep_alive ? "keep-alive" : "close", "\r\n",
+				"\r\n",
+				response.body
+			) };
+			for (size_t pos{ 0ull }; pos < data.size(); ) {
+				const auto n{ ::send(sd, data.data() + pos, static_cast<int>(data.size() - pos), 0) };
+				if (n <= 0)
+					return false;
+				pos += static_cast<size_t>(n);
+			}
+			return true;
+		}
+	};
+}
+
+namespace mode {
+	/**
+	 * @brief			Route a gateway request.
+	 * @param pools		The host pools.
+	 * @param request	The request.
+	 * @returns			net::http::Response
+	 */
+	inline net::http::Response route(net::PoolRegistry& pools, const net::http::Request& request)
+	{
+		using net::http::Response;
+
+		if (request.has_origin)
+			return Response::error(403, "Requests from web pages aren't allowed.");
+		const std::string_view host{ std::string_view{ request.host }.substr(0ull, request.host.rfind(':')) };
+		if (host != "127.0.0.1" && host != "localhost")
+			return Response::error(403, "The Host header must be 127.0.0.1 or localhost.");
+
+		std::string_view path{ request.path }, query;
+		if (const auto pos{ path.find('?') }; pos != std::string_view::npos) {
+			query = path.substr(pos + 1ull);
+			path = path.substr(0ull, pos);
+		}
+
+		if (path == "/hosts") {
+			if (request.method != "GET")
+				return Response::error(405, "Use GET to list hosts.");
+			std::string array{ "[" };
+			for (const auto& name : pools.names()) {
+				if (array.size() > 1ull)
+					array.push_back(',');
+				json::append_string(array, name);
+			}
+			array.push_back(']');
+			return{ 200, json::Object{}.add_raw("hosts", array).str() };
+		}
+
+		// /hosts/<name>/<action>
+		if (!path.starts_with("/hosts/"))
+			return Response::error(404, "Unknown endpoint.");
+		path.remove_prefix(7ull);
+		const auto slash{ path.rfind('/') };
+		if (slash == std::string_view::npos)
+			return Response::error(404, "Unknown endpoint.");
+		const std::string name{ path.substr(0ull, slash) };
+		const auto action{ path.substr(slash + 1ull) };
+
+		auto* pool{ pools.get(name) };
+		if (pool == nullptr)
+			return Response::error(404, "There is no host named \"" + name + "\".");
+
+		if (action == "status") {
+			if (request.method != "GET")
+				return Response::error(405, "Use GET to get a host's status.");
+			const auto status{ pool->status() };
+			return{ 200, json::Object{}
+				.add("host", name)
+				.add("sessions", status.sessions)
+				.add("connected", status.connected)
+				.add("queued", status.queued)
+				.add("completed", status.completed)
+				.add("errors", status.errors)
+				.add("coalesced", status.coalesced)
+				.add_raw("lanes", to_json(status.lanes))
+				.str() };
+		}
+		else if (action == "command") {
+			if (request.method != "POST")
+				return Response::error(405, "Use POST to execute a command.");
+			if (std::string_view type{ request.content_type }; !type.starts_with("application/json") || (type.size() > 16ull && type[16] != ';' && type[16] != ' '))
+				return Response::error(415, "The Content-Type must be application/json.");
+			std::string command;
+			try {
+				const auto body{ json::parse(request.body) };
+				if (const auto* value{ body.find("command") }; value != nullptr && value->is_string())
+					command = str::strip_line(value->string);
+			} catch (const std::exception& ex) {
+				return Response::error(400, ex.what());
+			}
+			if (command.empty())
+				return Response::error(400, "The request body must be an object with a \"command\".");
+			auto priority{ net::Priority::NORMAL };
+			for (std::string_view rest{ query }; !rest.empty(); ) {
+				const auto amp{ rest.find('&') };
+				const auto param{ rest.substr(0ull, amp) };
+				rest = amp == std::string_view::npos ? std::string_view{} : rest.substr(amp + 1ull);
+				if (param.starts_with("priority=")) {
+					if (const auto p{ net::parse_priority(param.substr(9ull)) }; p.has_value())
+						priority = p.value();
+					else return Response::error(400, "Invalid priority \"" + std::string{ param.substr(9ull) } + "\"; expected \"high\", \"normal\", or \"low\".");
+				}
+			}
+			const auto result{ pool->submit(command, priority).get() };
+			return{ result.error.empty() ? 200 : 502, net::to_json(name, command, result).str() };
+		}
+		return Response::error(404, "Unknown endpoint.");
+	}
+
+	/**
+	 * @brief				Serve the HTTP/JSON gateway on localhost until interrupted.
+	 * @param pools			The host pools that requests are executed with.
+	 * @param port			Local port to listen on.
+	 * @param upgrade_path	Location of a UNIX socket used for zero-downtime upgrades, or an empty path to disable them.
+	 *\n					If another gateway is listening on it, its listening socket & open sessions are taken over
+	 *\n					once it has finished its in-flight requests. Then this gateway listens on it for its own successor.
+	 */
+	inline void gateway(net::PoolRegistry& pools, const std::string& port, const std::filesystem::path& upgrade_path = {})
+	{
+		SOCKET listener{ static_cast<SOCKET>(SOCKET_ERROR) };
+		std::unique_ptr<net::handoff::Server> upgrade;
+		if (!upgrade_path.empty()) {
+			if (const auto handoff{ net::handoff::request(upgrade_path) }; handoff.has_value()) {
+				listener = handoff->listener;
+				const auto adopted{ pools.adopt(handoff->sessions) };
+				if (!Global.quiet)
+					std::cout << Global.palette.get_msg() << "Took over the listening socket & " << adopted << " sessions from the previous process." << std::endl;
+			}
+			upgrade = std::make_unique<net::handoff::Server>(upgrade_path);
+		}
+		if (listener == static_cast<SOCKET>(SOCKET_ERROR))
+			listener = net::listen("127.0.0.1", port);
+
+	#ifdef OS_WIN
+		if (!SetConsoleCtrlHandler(sighandler, TRUE))
+			throw make_exception("Failed to install Windows Control+C handler!");
+	#else
+		struct sigaction action {};
+		action.sa_handler = sighandler;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = 0;
+		sigaction(SIGINT, &action, nullptr);
+	#endif
+		Global.connected = true;
+
+		if (!Global.quiet)
+			std::cout << Global.palette.get_msg() << "Serving the gateway on http://127.0.0.1:" << port << "/; use <Ctrl + C> to stop." << std::endl;
+
+		std::atomic<size_t> active{ 0ull };
+		std::atomic<bool> draining{ false };
+		std::mutex clients_mtx;
+		std::set<SOCKET> clients;
+		const auto drain{ [&] {
+			draining = true;
+			{ // wake idle keep-alive connections so that their threads exit; in-flight responses are still written
+				std::scoped_lock lock(clients_mtx);
+				for (const auto& client : clients)
+					::shutdown(client, SHUT_RD);
+			}
+			while (active.load() != 0ull)
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+		} };
+
+		fd_set set;
+		while (Global.connected) {
+			FD_ZERO(&set);
+			FD_SET(listener, &set);
+			auto max_fd{ listener };
+			if (upgrade) {
+				FD_SET(upgrade->fd(), &set);
+				max_fd = std::max(max_fd, static_cast<SOCKET>(upgrade->fd()));
+			}
+			const auto timeout{ net::make_exact_timeout(std::chrono::milliseconds{ 250 }) };
+			if (SELECT(max_fd + 1ll, &set, nullptr, nullptr, &timeout) < 1)
+				continue;
+
+			if (upgrade && FD_ISSET(upgrade->fd(), &set)) {
+				if (const int conn{ upgrade->accept() }; conn != -1) {
+					// stop accepting; new clients wait in the listen queue until the new process accepts them
+					drain();
+					const auto sessions{ pools.release() };
+					const bool ok{ net::handoff::Server::send(conn, listener, sessions) };
+					::close(conn);
+					if (ok) {
+						for (const auto& session : sessions)
+							net::close_socket(session.sd);
+						net::close_socket(listener);
+						if (!Global.quiet)
+							std::cout << Global.palette.get_msg() << "Handed the gateway & " << sessions.size() << " sessions over to the new process." << std::endl;
+						return;
+					}
+					// keep the authenticated sessions, rather than reconnecting to every host
+					pools.adopt(sessions);
+					std::cerr << Global.palette.get_error() << "Failed to hand the gateway over to the new process; continuing." << std::endl;
+					draining = false;
+				}
+			}
+			if (!FD_ISSET(listener, &set))
+				continue;
+			const SOCKET client{ static_cast<SOCKET>(::accept(listener, nullptr, nullptr)) };
+			if (client == static_cast<SOCKET>(SOCKET_ERROR))
+				continue;
+
+			++active;
+			{
+				std::scoped_lock lock(clients_mtx);
+				clients.insert(client);
+			}
+			std::thread([&pools, &active, &draining, &clients_mtx, &clients, client]() {
+				{
+					net::http::Connection connection{ client };
+					net::http::Request request;
+					for (int rc; Global.connected && (rc = connection.read(request)) != -1; ) {
+						if (rc != 0) {
+							connection.write(net::http::Response::error(rc, "Malformed request."), false);
+							break;
+						}
+						net::http::Response response;
+						try {
+							response = route(pools, request);
+						} catch (const std::exception& ex) {
+							response = net::http::Response::error(500, ex.what());
+						}
+						const bool keep_alive{ request.keep_alive && !draining };
+						if (!connection.write(response, keep_alive) || !keep_alive)
+							break;
+					}
+					// remove the client before its socket is closed, so that drain() can't shut down a reused descriptor
+					std::scoped_lock lock(clients_mtx);
+					clients.erase(client);
+				}
+				--active;
+			}).detach();
+		}
+		net::close_socket(listener);
+
+		// close idle connections & wait for in-flight requests to finish before the pools are destroyed
+		drain();
+	}
+}
@@ -0,0 +1,268 @@
+/**
+ * @file	handoff.hpp
+ * @author	radj307
+ * @brief	Contains functions used to hand a running gateway's listening socket & authenticated sessions to a new process
+ *\n		over a UNIX socket, so that the binary can be upgraded without dropping connections or re-authenticating.
+ *\n
+ *\n		Protocol (SOCK_SEQPACKET, one message per line):
+ *\n		  new -> old	'T'												Request a takeover.
+ *\n		  old -> new	'L' + SCM_RIGHTS(listener)						The listening socket.
+ *\n		  old -> new	'S' name\0hostname\0port\0password + SCM_RIGHTS(sd)	One authenticated session.
+ *\n		  old -> new	'E'												End of the handoff.
+ */
+#pragma once
+#include "pool.hpp"
+
+#include <make_exception.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+#ifdef OS_LINUX
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace net::handoff {
+	/**
+	 * @struct	Handoff
+	 * @brief	The sockets received from the previous process.
+	 */
+	struct Handoff {
+		SOCKET listener;
+		std::vector<PooledSocket> sessions;
+	};
+
+#ifdef OS_LINUX
+	/// @brief	Create the address of a UNIX socket.
+	inline sockaddr_un make_address(const std::filesystem::path& path)
+	{
+		sockaddr_un addr{};
+		addr.sun_family = AF_UNIX;
+		const auto str{ path.string() };
+		if (str.size() >= sizeof(addr.sun_path))
+			throw make_exception("The upgrade socket path ", path, " is too long!");
+		str.copy(addr.sun_path, str.size());
+		return addr;
+	}
+
+	/**
+	 * @brief			Send a message, optionally with a file descriptor.
+	 * @param conn		The UNIX socket.
+	 * @param message	The message.
+	 * @param fd		A file descriptor to send, or -1.
+	 * @returns			bool	false when the message couldn't be sent.
+	 */
+	inline bool send_message(const int conn, std::string message, const int fd = -1)
+	{
+		iovec iov{ message.data(), message.size() };
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+		if (fd != -1) {
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+			auto* cmsg{ CMSG_FIRSTHDR(&msg) };
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_RIGHTS;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+			std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+		}
+		return ::sendmsg(conn, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(message.size());
+	}
+
+	/**
+	 * @brief			Receive a message, & the file descriptor sent with it if there is one.
+	 * @param conn		The UNIX socket.
+	 * @param message	Receives the message.
+	 * @param fd		Receives the file descriptor, or -1.
+	 * @returns			bool	false when the connection was closed or timed out.
+	 */
+	inline bool recv_message(const int conn, std::string& message, int& fd)
+	{
+		message.resize(4096ull);
+		iovec iov{ message.data(), message.size() };
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		const auto len{ ::recvmsg(conn, &msg, MSG_CMSG_CLOEXEC) };
+		if (len <= 0)
+			return false;
+		message.resize(static_cast<size_t>(len));
+		fd = -1;
+		if (const auto* cmsg{ CMSG_FIRSTHDR(&msg) }; cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+		return true;
+	}
+
+	/**
+	 * @brief			Ask the process listening on a UNIX socket to hand over its sockets, & wait for it to finish its
+	 *\n				in-flight requests & do so.
+	 * @param path		Location of the UNIX socket.
+	 * @throws except	The handoff started, but didn't complete.
+	 * @returns			std::optional<Handoff>
+	 *\n				std::nullopt when no process is listening on the socket.
+	 */
+	inline std::optional<Handoff> request(const std::filesystem::path& path)
+	{
+		const int conn{ ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0) };
+		if (conn == -1)
+			return std::nullopt;
+		const auto addr{ make_address(path) };
+		if (::connect(conn, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || !send_message(conn, "T")) {
+			::close(conn);
+			return std::nullopt;
+		}
+
+		// the previous process finishes its in-flight requests first, so allow plenty of time
+		const timeval timeout{ 60, 0 };
+		setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		Handoff handoff{ static_cast<SOCKET>(SOCKET_ERROR), {} };
+		const auto fail{ [&](const std::string& reason) {
+			if (handoff.listener != static_cast<SOCKET>(SOCKET_ERROR))
+				close_socket(handoff.listener);
+			for (const auto& session : handoff.sessions)
+				close_socket(session.sd);
+			::close(conn);
+			return make_exception("Failed to take over from the previous process: ", reason);
+		} };
+
+		for (std::string message; ; ) {
+			int fd;
+			if (!recv_message(conn, message, fd))
+				throw fail("the connection was closed.");
+			if (message == "E" && handoff.listener != static_cast<SOCKET>(SOCKET_ERROR))
+				break;
+			if (fd == -1)
+				throw fail("a message was missing its socket.");
+			if (message == "L")
+				handoff.listener = static_cast<SOCKET>(fd);
+			else if (message.front() == 'S') {
+				std::vector<std::string> fields;
+				for (size_t pos{ 1ull }; pos <= message.size(); ) {
+					const auto end{ std::min(message.find('\0', pos), message.size()) };
+					fields.emplace_back(message.substr(pos, end - pos));
+					pos = end + 1ull;
+				}
+				if (fields.size() != 4ull) {
+					::close(fd);
+					throw fail("a session message was malformed.");
+				}
+				handoff.sessions.emplace_back(PooledSocket{ fields[0], HostInfo{ fields[1], fields[2], fields[3] }, static_cast<SOCKET>(fd) });
+			}
+			else {
+				::close(fd);
+				throw fail("an unknown message was received.");
+			}
+		}
+		::close(conn);
+		return handoff;
+	}
+
+	/**
+	 * @class	Server
+	 * @brief	Listens on a UNIX socket for a new process that wants to take over.
+	 */
+	class Server {
+		int sd;
+
+	public:
+		/**
+		 * @brief			Listen on a UNIX socket. An existing file at the path is replaced.
+		 *\n				The socket is only accessible to the current user, since sessions' passwords are sent over it.
+		 * @param path		Location of the UNIX socket.
+		 * @throws except	The socket couldn't be created.
+		 */
+		Server(const std::filesystem::path& path) : sd{ ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0) }
+		{
+			const auto addr{ make_address(path) };
+			::unlink(path.c_str());
+			const auto mask{ ::umask(0077) };
+			const bool ok{ sd != -1 && ::bind(sd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0 && ::listen(sd, 1) == 0 };
+			::umask(mask);
+			if (!ok) {
+				if (sd != -1)
+					::close(sd);
+				throw make_exception("Failed to listen on the upgrade socket ", path, ": ", getLastSocketErrorMessage());
+			}
+		}
+		Server(const Server&) = delete;
+		Server& operator=(const Server&) = delete;
+		/// @brief	Stop listening. The socket file isn't removed, since a new process may have replaced it.
+		~Server() { ::close(sd); }
+
+		/// @brief	Get the listening socket, for use with select().
+		int fd() const { return sd; }
+
+		/**
+		 * @brief	Accept a takeover request.
+		 * @returns	int	The connection to the new process, or -1 if the connection wasn't a takeover request.
+		 */
+		int accept() const
+		{
+			const int conn{ ::accept4(sd, nullptr, nullptr, SOCK_CLOEXEC) };
+			if (conn == -1)
+				return -1;
+			const timeval timeout{ 5, 0 };
+			setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+			std::string message;
+			int fd;
+			if (recv_message(conn, message, fd) && message == "T")
+				return conn;
+			if (fd != -1)
+				::close(fd);
+			::close(conn);
+			return -1;
+		}
+
+		/**
+		 * @brief			Send the listening socket & released sessions to the new process.
+		 *\n				The caller should close its copies of the sockets afterwards.
+		 * @param conn		The connection returned by accept().
+		 * @param listener	The listening socket.
+		 * @param sessions	The released sessions.
+		 * @returns			bool	false when the handoff couldn't be completed.
+		 */
+		static bool send(const int conn, const SOCKET& listener, const std::vector<PooledSocket>& sessions)
+		{
+			if (!send_message(conn, "L", static_cast<int>(listener)))
+				return false;
+			for (const auto& session : sessions) {
+				std::string message{ "S" };
+				message.append(session.name).append(1ull, '\0')
+					.append(session.target.hostname).append(1ull, '\0')
+					.append(session.target.port).append(1ull, '\0')
+					.append(session.target.password);
+				if (!send_message(conn, std::move(message), static_cast<int>(session.sd)))
+					return false;
+			}
+			return send_message(conn, "E");
+		}
+	};
+#else
+	inline std::optional<Handoff> request(const std::filesystem::path&)
+	{
+		throw make_exception("Upgrade handoff is only supported on Linux!");
+	}
+
+	class Server {
+	public:
+		Server(const std::filesystem::path&) { throw make_exception("Upgrade handoff is only supported on Linux!"); }
+		int fd() const { return -1; }
+		int accept() const { return -1; }
+		static bool send(const int, const SOCKET&, const std::vector<PooledSocket>&) { return false; }
+	};
+#endif
+}
@@ -0,0 +1,175 @@
+/**
+ * @file	load.hpp
+ * @author	radj307
+ * @brief	Contains the load generator mode, which drives a weighted mix of commands at a target rate
+ *\n		over several concurrent sessions for capacity testing.
+ */
+#pragma once
+#include "bench.hpp"
+
+#include <filei.hpp>
+#include <str.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <random>
+
+namespace mode {
+	/**
+	 * @struct	WeightedCommand
+	 * @brief	A command & its relative weight in a load mix.
+	 */
+	struct WeightedCommand {
+		double weight;
+		std::string command;
+	};
+
+	/**
+	 * @brief			Read a load mix file. Each line contains a weight followed by a command, separated by whitespace.
+	 *\n				Blank lines & comments beginning with a semicolon or pound sign are ignored.
+	 * @param path		Location of the mix file.
+	 * @throws except	The file couldn't be read, or a line is missing its weight.
+	 * @returns			std::vector<WeightedCommand>
+	 */
+	inline std::vector<WeightedCommand> read_mix_file(const std::filesystem::path& path)
+	{
+		auto fss{ file::read(path) };
+		if (fss.fail())
+			throw make_exception("Failed to read mix file ", path, '!');
+
+		std::vector<WeightedCommand> mix;
+		for (std::string ln{}; std::getline(fss, ln, '\n'); ) {
+			if (ln = str::strip_line(ln, "#;"); ln.empty())
+				continue;
+			const auto split{ ln.find_first_of(" \t") };
+			try {
+				if (split == std::string::npos)
+					throw std::invalid_argument(ln);
+				mix.emplace_back(WeightedCommand{ std::stod(ln.substr(0ull, split)), str::strip_line(ln.substr(split + 1ull)) });
+			} catch (const std::exception&) {
+				throw make_exception("Invalid line in mix file ", path, ": \"", ln, "\", expected \"<weight> <command>\".");
+			}
+		}
+		return mix;
+	}
+
+	/**
+	 * @brief				Generate load against a target server.
+	 *\n					Each session sends commands at an even share of the target rate, picking each command at random
+	 *\n					according to its weight. Latency is measured from the time each command was scheduled to be sent,
+	 *\n					so that a slow server doesn't hide its own queueing delay by slowing down the generator.
+	 *\n					A command that fails is counted as an error, & its session is reopened for the next scheduled command.
+	 * @param target		The target server's connection information.
+	 * @param mix			Commands to send, with their relative weights.
+	 * @param sessions		Number of concurrent authenticated sessions.
+	 * @param rate			Target total command rate, in commands per second. 0 sends as fast as possible.
+	 * @param duration		How long to generate load for.
+	 */
+	inline void load(const net::HostInfo& target, const std::vector<WeightedCommand>& mix, const size_t& sessions, const double& rate, const std::chrono::seconds& duration)
+	{
+		using clock = std::chrono::steady_clock;
+		using namespace std::chrono_literals;
+
+		if (mix.empty())
+			throw make_exception("No commands were specified to generate load with!");
+		if (sessions == 0ull)
+			throw make_exception("The number of load sessions must be greater than 0!");
+
+		std::vector<double> weights;
+		weights.reserve(mix.size());
+		for (const auto& it : mix)
+			weights.emplace_back(it.weight);
+
+		// open all sessions before starting the clock
+		std::vector<net::Session> conns;
+		conns.reserve(sessions);
+		Latencies connect, auth;
+		for (size_t i{ 0ull }; i < sessions; ++i) {
+			auto& session{ conns.emplace_back(target) };
+			connect.add(session.connect_time);
+			auth.add(session.auth_time);
+		}
+
+		std::mutex mtx;
+		std::condition_variable cv;
+		Latencies interval, total;
+		size_t interval_sent{ 0ull }, interval_errors{ 0ull }, total_errors{ 0ull };
+		std::atomic<size_t> live_sessions{ sessions };
+
+		const auto t0{ clock::now() };
+		const auto end{ t0 + duration };
+		const auto period{ rate > 0.0 ? std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(static_cast<double>(sessions) / rate)) : clock::duration::zero() };
+
+		std::vector<std::thread> workers;
+		workers.reserve(sessions);
+		for (size_t w{ 0ull }; w < sessions; ++w) {
+			workers.emplace_back([&, w]() {
+				std::mt19937_64 rng{ std::random_device{}() ^ w };
+				std::discrete_distribution<size_t> pick{ weights.begin(), weights.end() };
+				// stagger the sessions evenly across the first period
+				auto next{ t0 + period * static_cast<clock::rep>(w) / static_cast<clock::rep>(sessions) };
+				while (next < end) {
+					std::this_thread::sleep_until(next);
+					try {
+						// sessions are closed when a command times out
+						if (!conns[w].is_open())
+							conns[w].open(target);
+						const bool ok{ conns[w].exchange(mix[pick(rng)].command, [](const net::packet::Packet&) {}) };
+						const auto latency{ clock::now() - next };
+						std::scoped_lock lock(mtx);
+						++interval_sent;
+						interval_errors += static_cast<size_t>(!ok);
+						interval.add(latency);
+					} catch (const std::exception&) {
+						// the session is reopened for the next scheduled command
+						conns[w].close();
+						std::scoped_lock lock(mtx);
+						++interval_sent;
+						++interval_errors;
+					}
+					next = (period == clock::duration::zero()) ? clock::now() : next + period;
+				}
+				--live_sessions;
+				cv.notify_all();
+			});
+		}
+
+		std::cout << "Generating load against " << target.hostname << ':' << target.port << " with " << sessions << " sessions";
+		if (rate > 0.0)
+			std::cout << " at " << rate << " cmd/s";
+		std::cout << " for " << duration.count() << "s\n" << std::endl;
+
+		// report once per second until the duration has elapsed or every session has stopped
+		auto last_report{ t0 };
+		for (auto report_at{ t0 + 1s }; ; report_at += 1s) {
+			std::unique_lock lock(mtx);
+			const bool done{ cv.wait_until(lock, std::min(report_at, end), [&]() { return live_sessions.load() == 0ull; }) || report_at >= end };
+			const auto now{ clock::now() };
+			const auto interval_seconds{ std::chrono::duration<double>(now - last_report).count() };
+			last_report = now;
+			std::cout << "  t=" << std::fixed << std::setprecision(1) << std::setw(6) << std::chrono::duration<double>(now - t0).count()
+				<< "s  rate=" << std::setw(8) << (interval_seconds > 0.0 ? static_cast<double>(interval_sent) / interval_seconds : 0.0) << " cmd/s  errors=" << interval_errors;
+			const auto ms{ [](const std::chrono::nanoseconds& ns) { return std::chrono::duration<double, std::milli>(ns).count(); } };
+			std::cout << std::setprecision(3) << "  p50=" << ms(interval.percentile(50)) << "ms  p99=" << ms(interval.percentile(99)) << "ms  max=" << ms(interval.percentile(100)) << "ms" << std::endl;
+			total.merge(interval);
+			total_errors += interval_errors;
+			interval = {};
+			interval_sent = interval_errors = 0ull;
+			if (done)
+				break;
+		}
+
+		for (auto& worker : workers)
+			worker.join();
+		total_errors += interval_errors;
+		total.merge(interval);
+
+		const auto elapsed{ clock::now() - t0 };
+		std::cout << '\n';
+		print_throughput(std::cout, "total", total.samples.size(), elapsed);
+		total.print(std::cout, "latency");
+		connect.print(std::cout, "connect");
+		auth.print(std::cout, "auth");
+		std::cout << "  errors:  " << total_errors << std::endl;
+	}
+}
@@ -0,0 +1,159 @@
+/**
+ * @file	lua-engine.hpp
+ * @author	radj307
+ * @brief	Contains the embedded Lua scripting mode, which runs multi-step automation over a single authenticated session.
+ *\n		Only available when ARRCON is built with ARRCON_ENABLE_LUA.
+ *\n
+ *\n		Scripts can use the following functions from the "rcon" table:
+ *\n		  rcon.command(cmd)			Send a command; returns the response string (converted to UTF-8) & a boolean indicating whether the server responded.
+ *\n		  rcon.lines(str)			Iterate over the lines in a string.
+ *\n		  rcon.strip_colors(str)	Remove Minecraft section-sign color codes from a string.
+ *\n		  rcon.sleep(ms)			Wait for the given number of milliseconds.
+ *\n		  rcon.host, rcon.port		The target's connection information.
+ *\n		Extra commandline parameters are available in the global "arg" table.
+ */
+#pragma once
+#include "../globals.h"
+#include "rcon.hpp"
+#include "../filter.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef ARRCON_HAS_LUA
+#include <lua.hpp>
+#endif
+
+namespace mode {
+#	ifdef ARRCON_HAS_LUA
+	namespace lua_bindings {
+		/// @brief	rcon.command(cmd) -> response, ok
+		inline int command(lua_State* L)
+		{
+			size_t len{};
+			const char* cmd{ luaL_checklstring(L, 1, &len) };
+			// luaL_error() doesn't unwind the C++ stack, so it is only called once every local object is destroyed
+			char error[256]{};
+			{
+				std::string response;
+				bool ok{ false };
+				try {
+					ok = net::rcon::exchange(Global.socket, std::string{ cmd, len }, [&response](const net::packet::Packet& p) { response += p.body; });
+				} catch (const std::exception& ex) {
+					std::snprintf(error, sizeof(error), "%s", ex.what());
+				}
+				if (error[0] == '\0') {
+					std::string buffer;
+					const auto text{ encoding::to_utf8(response, Global.encoding, buffer) };
+					lua_pushlstring(L, text.data(), text.size());
+					lua_pushboolean(L, ok);
+					return 2;
+				}
+			}
+			return luaL_error(L, "%s", error);
+		}
+
+		/// @brief	Iterator function used by rcon.lines()
+		inline int lines_next(lua_State* L)
+		{
+			size_t len{};
+			const char* str{ lua_tolstring(L, lua_upvalueindex(1), &len) };
+			auto pos{ static_cast<size_t>(lua_tointeger(L, lua_upvalueindex(2))) };
+			if (pos >= len)
+				return 0;
+			const std::string_view view{ str, len };
+			auto end{ view.find('\n', pos) };
+			if (end == std::string_view::npos)
+				end = len;
+			auto line_end{ end };
+			if (line_end > pos && view[line_end - 1] == '\r')
+				--line_end;
+			lua_pushinteger(L, static_cast<lua_Integer>(end + 1));
+			lua_replace(L, lua_upvalueindex(2));
+			lua_pushlstring(L, str + pos, line_end - pos);
+			return 1;
+		}
+
+		/// @brief	rcon.lines(str) -> iterator
+		inline int lines(lua_State* L)
+		{
+			luaL_checkstring(L, 1);
+			lua_settop(L, 1);
+			lua_pushinteger(L, 0);
+			lua_pushcclosure(L, lines_next, 2);
+			return 1;
+		}
+
+		/// @brief	rcon.strip_colors(str) -> str
+		inline int strip_colors(lua_State* L)
+		{
+			size_t len{};
+			const char* str{ luaL_checklstring(L, 1, &len) };
+			std::string buffer;
+			const auto out{ filter::strip_colors({ str, len }, buffer) };
+			lua_pushlstring(L, out.data(), out.size());
+			return 1;
+		}
+
+		/// @brief	rcon.sleep(ms)
+		inline int sleep(lua_State* L)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds{ luaL_checkinteger(L, 1) });
+			return 0;
+		}
+	}
+#	endif
+
+	/**
+	 * @brief			Run a Lua script over the connected session.
+	 * @param path		Location of the Lua script.
+	 * @param args		Extra arguments to pass to the script in the global "arg" table.
+	 * @throws except	ARRCON wasn't built with Lua support, or the script failed.
+	 */
+	inline void lua(const std::string& path, const std::vector<std::string>& args)
+	{
+#		ifdef ARRCON_HAS_LUA
+		const std::unique_ptr<lua_State, decltype(&lua_close)> state{ luaL_newstate(), &lua_close };
+		lua_State* L{ state.get() };
+		if (L == nullptr)
+			throw make_exception("Failed to create the Lua interpreter!");
+		luaL_openlibs(L);
+
+		// rcon table
+		const luaL_Reg functions[]{
+			{ "command", lua_bindings::command },
+			{ "lines", lua_bindings::lines },
+			{ "strip_colors", lua_bindings::strip_colors },
+			{ "sleep", lua_bindings::sleep },
+			{ nullptr, nullptr },
+		};
+		luaL_newlib(L, functions);
+		lua_pushstring(L, Global.target.hostname.c_str());
+		lua_setfield(L, -2, "host");
+		lua_pushstring(L, Global.target.port.c_str());
+		lua_setfield(L, -2, "port");
+		lua_setglobal(L, "rcon");
+
+		// arg table
+		lua_createtable(L, static_cast<int>(args.size()), 1);
+		lua_pushstring(L, path.c_str());
+		lua_rawseti(L, -2, 0);
+		for (size_t i{ 0ull }; i < args.size(); ++i) {
+			lua_pushstring(L, args[i].c_str());
+			lua_rawseti(L, -2, static_cast<lua_Integer>(i + 1ull));
+		}
+		lua_setglobal(L, "arg");
+
+		if (luaL_dofile(L, path.c_str()) != LUA_OK)
+			throw make_exception("Lua script failed: ", lua_tostring(L, -1));
+#		else
+		(void)path;
+		(void)args;
+		throw make_exception("This build of ARRCON doesn't support Lua scripts! (Rebuild with -DARRCON_ENABLE_LUA=ON)");
+#		endif
+	}
+}
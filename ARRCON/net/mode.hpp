@@ -8,10 +8,16 @@
 #include <term.hpp>
 #include "../globals.h"
 #include "rcon.hpp"
+#include "../script.hpp"
+#include "../checkpoint.hpp"
+#include "../csv.hpp"
+#include "../lineedit.hpp"
+#include "completion.hpp"
 
 #include <str.hpp>
 
 #include <iostream>	///< for std::cout & std::cerr
+#include <memory>	///< for std::unique_ptr
 #include <thread>	///< for this_thread::sleep_for
 #include <signal.h>	///< for signal handling
 #include <unistd.h>	///< for signal handling
@@ -67,18 +73,144 @@ inline std::istream& readline(std::istream& is, std::string& s)
 namespace mode {
 
 	/**
-	 * @brief			Execute a list of commands.
-	 * @param commands	List of commands to execute, in order.
+	 * @brief			Execute a single command, echoing it first unless the prompt is disabled.
+	 * @param cmd		The command to execute.
+	 * @param response	Optional string that receives the body of every response packet.
+	 * @param local		Optional filter that only applies to this command's response. See print_packet().
+	 * @returns			bool	true when the server responded.
+	 */
+	inline bool execute(const std::string& cmd, std::string* response = nullptr, const filter::Filter* local = nullptr)
+	{
+		if (!Global.quiet && !Global.no_prompt)
+			std::cout << Global.custom_prompt << Global.palette.set(Color::GREEN) << cmd << Global.palette.reset() << '\n';
+		std::string published;
+		if (response == nullptr && net::feed::feed.is_open())
+			response = &published;
+		if (response != nullptr)
+			response->clear();
+		const bool success{ net::rcon::command(Global.socket, cmd, [&response, &local](const net::packet::Packet& p) {
+			if (!Global.quiet)
+				print_packet(std::cout, p, local);
+			if (response != nullptr)
+				*response += p.body;
+		}) };
+		std::cout.flush() << Global.palette.reset();
+		if (response != nullptr)
+			net::feed::feed.publish_response(Global.target.hostname, cmd, *response);
+		std::this_thread::sleep_for(Global.command_delay.load());
+		return success;
+	}
+
+	/**
+	 * @brief			Wait for a response that matches an "@expect" directive.
+	 *\n				The previous response is checked first, then packets that arrive before the timeout are
+	 *\n				printed & checked as they're received.
+	 * @param expect	The parsed directive.
+	 * @param response	The previous command's response. Packets received while waiting are appended to it.
+	 * @returns			bool	true when a match was found before the timeout expired.
+	 */
+	inline bool wait_for_match(const script::Expect& expect, std::string& response)
+	{
+		if (std::regex_search(response, expect.pattern))
+			return true;
+
+		const auto deadline{ std::chrono::steady_clock::now() + expect.timeout };
+		fd_set set;
+		for (auto now{ std::chrono::steady_clock::now() }; now < deadline && Global.connected; now = std::chrono::steady_clock::now()) {
+			FD_ZERO(&set);
+			FD_SET(Global.socket, &set);
+			const auto timeout{ net::make_exact_timeout(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) + std::chrono::milliseconds{ 1 }) };
+			if (SELECT(Global.socket + 1ll, &set, nullptr, nullptr, &timeout) != 1)
+				continue;
+			const auto p{ net::recv_packet(Global.socket) };
+			if (!Global.quiet)
+				(std::cout << p).flush() << Global.palette.reset();
+			response += p.body;
+			if (std::regex_search(p.body, expect.pattern) || std::regex_search(response, expect.pattern))
+				return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @brief				Execute a list of commands.
+	 * @param commands		List of commands to execute, in order.
+	 * @param checkpoint	Optional checkpoint that records progress. When specified, execution begins after the
+	 *\n					last command recorded by the checkpoint, and each command is acknowledged once it receives a response.
+	 *\n					Once a command doesn't receive a response, the checkpoint stops advancing, so that resuming the
+	 *\n					script begins at that command instead of skipping it.
+	 * @returns size_t		Number of commands successfully executed.
+	 */
+	inline size_t commandline(const std::vector<std::string>& commands, Checkpoint* checkpoint = nullptr)
+	{
+		const auto labels{ script::find_labels(commands) };
+		const auto jump{ [&labels](const std::string& label) -> size_t {
+			if (const auto it{ labels.find(label) }; it != labels.end())
+				return it->second;
+			throw make_exception("Script jumped to label \"", label, "\", which doesn't exist!");
+		} };
+
+		size_t count{ 0ull };
+		std::string response;
+		filter::Filter local; //< filter for the next command, from "@grep" & "@exclude" directives
+		bool answered{ true }; //< false once a command didn't receive a response
+		for (size_t i{ checkpoint != nullptr ? checkpoint->get_completed() : 0ull }, next; i < commands.size(); i = next) {
+			const auto& cmd{ commands[i] };
+			next = i + 1ull;
+			if (const auto directive{ script::parse_directive(cmd) }; !directive.has_value()) {
+				if (execute(script::unescape(cmd), &response, &local))
+					++count;
+				else answered = false;
+				local.clear();
+			}
+			else if (directive->name == script::directive::GREP)
+				local.include(directive->args);
+			else if (directive->name == script::directive::EXCLUDE)
+				local.exclude(directive->args);
+			else if (directive->name == script::directive::EXPECT) {
+				const script::Expect expect{ directive->args };
+				if (wait_for_match(expect, response)) {
+					if (!expect.then_target.empty())
+						next = jump(expect.then_target);
+				}
+				else if (expect.else_target == script::Expect::ABORT)
+					throw make_exception("Script aborted on line ", i + 1ull, ": no response matched /", expect.pattern_string, "/ within ", expect.timeout.count(), "ms.");
+				else if (expect.else_target != script::Expect::CONTINUE)
+					next = jump(expect.else_target);
+				response.clear();
+			}
+			else if (directive->name == script::directive::GOTO)
+				next = jump(directive->args);
+			// other directives don't affect serial execution
+			if (checkpoint != nullptr && answered && Global.connected)
+				checkpoint->acknowledge(next);
+		}
+		return count;
+	}
+
+	/**
+	 * @brief			Expand a command template for each row of a delimited file & execute the results as they're read.
+	 *\n				The file is streamed, so memory usage stays constant regardless of the number of rows.
+	 * @param text		The command template. See csv::Template.
+	 * @param is		Input stream to read rows from. The first row must be a header.
+	 * @param delim		Field delimiter.
 	 * @returns size_t	Number of commands successfully executed.
 	 */
-	inline size_t commandline(const std::vector<std::string>& commands)
+	inline size_t templated(const std::string& text, std::istream& is, const char& delim)
 	{
+		csv::Reader reader{ is, delim };
+
+		std::vector<std::string> fields;
+		if (!reader.next(fields))
+			throw make_exception("The template input is empty; expected a header row!");
+		const csv::Template tmpl{ text, fields };
+
 		size_t count{ 0ull };
-		for (auto& cmd : commands) {
-			if (!Global.quiet && !Global.no_prompt)
-				std::cout << Global.custom_prompt << Global.palette.set(Color::GREEN) << cmd << Global.palette.reset() << '\n';
-			count += static_cast<int>(net::rcon::command(Global.socket, cmd)); // 0 or 1, command returns a boolean
-			std::this_thread::sleep_for(Global.command_delay);
+		for (std::string cmd; Global.connected && reader.next(fields); ) {
+			if (fields.size() == 1ull && fields.front().empty())
+				continue; // skip blank lines
+			tmpl.expand(fields, cmd);
+			count += static_cast<size_t>(execute(cmd));
 		}
 		return count;
 	}
@@ -86,9 +218,10 @@ namespace mode {
 	/**
 	 * @brief								Prompts the user for input & handles an interactive session.
 	 * @param sd							Connected RCON socket descriptor.
-	 * @param close_socket_before_return	When true, the socket is disconnected before returning.
+	 * @param completion_cache				Location of the tab completion cache for the current target.
+	 *\n									When empty, tab completion is disabled.
 	 */
-	inline void interactive(const SOCKET& sd)
+	inline void interactive(const SOCKET& sd, const std::filesystem::path& completion_cache = {})
 	{
 	#ifdef OS_WIN
 		if (!SetConsoleCtrlHandler(sighandler, TRUE))
@@ -107,6 +240,14 @@ namespace mode {
 
 		bool hasTriedAutoAdjustingTimeout{ false };
 
+		// Start refreshing tab completions in the background
+		std::unique_ptr<net::CompletionCache> completions;
+		if (!completion_cache.empty() && Global.enable_tab_completion)
+			completions = std::make_unique<net::CompletionCache>(completion_cache, Global.target);
+		const LineEditor editor{ [&completions](const std::string& word, const size_t& index) {
+			return completions ? completions->complete(word, index) : std::vector<std::string>{};
+		} };
+
 		// Begin interactive session:
 		if (!Global.no_prompt) {
 			std::cout << "Authentication Successful.\nUse <Ctrl + C> ";
@@ -117,10 +258,11 @@ namespace mode {
 
 		// check std::cin.good() for CTRL+C
 		while (Global.connected && std::cin.good()) {
-			std::cout << Global.custom_prompt;
+			(std::cout << Global.custom_prompt).flush();
 
 			std::string command;
-			std::getline(std::cin, command);
+			if (!editor.read(Global.custom_prompt, command, [] { return Global.connected.load(); }))
+				break;
 
 			if (Global.allow_exit && command == "exit")
 				break;
@@ -130,9 +272,9 @@ namespace mode {
 					if (!net::rcon::command(sd, command) && Global.enable_no_response_message && !Global.quiet) {
 						// nothing received:
 						if (!hasTriedAutoAdjustingTimeout && Global.auto_adjust_timeouts) {
-							if (const auto maxTime{ Global.select_timeout * 10 }, time{ net::wait_for_packet(sd, maxTime) };
+							if (const auto maxTime{ Global.select_timeout.load() * 10 }, time{ net::wait_for_packet(sd, maxTime) };
 								time != maxTime) {
-								Global.select_timeout = std::chrono::milliseconds{ math::CeilToNearestMultiple(time.count(), Global.select_timeout.count()) } + Global.select_timeout;
+								Global.select_timeout = std::chrono::milliseconds{ math::CeilToNearestMultiple(time.count(), Global.select_timeout.load().count()) } + Global.select_timeout.load();
 								hasTriedAutoAdjustingTimeout = true;
 							}
 						}
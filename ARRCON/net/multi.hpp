@@ -0,0 +1,266 @@
+/**
+ * @file	multi.hpp
+ * @author	radj307
+ * @brief	Contains the multi-session mode, which keeps authenticated sessions open to several hosts at once.
+ *\n		Used when [-S|--saved] is specified more than once.
+ */
+#pragma once
+#include "../globals.h"
+#include "mode.hpp"
+#include "session.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mode {
+	/**
+	 * @class	MultiSession
+	 * @brief	A set of named sessions, one of which is active.
+	 */
+	class MultiSession {
+		std::vector<std::pair<std::string, net::Session>> sessions;
+		/// @brief	Used to reopen sessions that were closed after a command timed out.
+		std::vector<net::HostInfo> targets;
+		size_t active{ 0ull };
+
+		/**
+		 * @brief			Execute a command on one session & render its response with every line tagged by the host's name.
+		 * @param index		Index of the session.
+		 * @param command	The command to execute.
+		 * @param out		Receives the rendered output.
+		 * @returns			bool	true when the server responded.
+		 */
+		bool run(const size_t& index, const std::string& command, std::string& out)
+		{
+			auto& [name, session] { sessions[index] };
+			std::stringstream buffer;
+			std::string response;
+			bool ok{ false };
+			try {
+				if (!session.is_open())
+					session.open(targets[index]);
+				ok = session.exchange(command, [&buffer, &response](const net::packet::Packet& p) {
+					if (!Global.quiet)
+						print_packet(buffer, p);
+					if (net::feed::feed.is_open())
+						response += p.body;
+				});
+				net::feed::feed.publish_response(name, command, response);
+				if (!ok && Global.enable_no_response_message && !Global.quiet)
+					buffer << Global.palette.set(Color::ORANGE) << "[no response]" << Global.palette.reset() << '\n';
+			} catch (const std::exception& ex) {
+				buffer << Global.palette.get_error() << ex.what() << '\n';
+			}
+
+			const auto tag{ str::stringify(Global.palette.set(Color::YELLOW), '[', name, ']', Global.palette.reset(), ' ') };
+			out.clear();
+			for (std::string ln; std::getline(buffer, ln); )
+				out.append(tag).append(ln).append(Global.palette.reset()).push_back('\n');
+			return ok;
+		}
+
+	public:
+		/**
+		 * @brief			Connect & authenticate with every target concurrently.
+		 *\n				Targets that fail are left disconnected with a warning, & are reopened by the next command sent to them.
+		 * @param targets	Pairs of target names & connection information.
+		 * @throws except	Every target failed to connect or authenticate.
+		 */
+		MultiSession(const std::vector<std::pair<std::string, net::HostInfo>>& targets)
+		{
+			sessions.resize(targets.size());
+			for (const auto& [_, info] : targets)
+				this->targets.emplace_back(info);
+			std::vector<std::string> errors(targets.size());
+			std::vector<std::thread> threads;
+			threads.reserve(targets.size());
+			for (size_t i{ 0ull }; i < targets.size(); ++i) {
+				threads.emplace_back([&, i]() {
+					sessions[i].first = targets[i].first;
+					try {
+						sessions[i].second.open(targets[i].second);
+					} catch (const std::exception& ex) {
+						errors[i] = ex.what();
+					}
+				});
+			}
+			for (auto& thread : threads)
+				thread.join();
+			size_t failed{ 0ull };
+			for (size_t i{ 0ull }; i < errors.size(); ++i) {
+				if (errors[i].empty())
+					continue;
+				++failed;
+				if (!Global.quiet)
+					std::cerr << Global.palette.get_warn() << "Failed to open a session with " << Global.palette.set_or(Color::YELLOW, '\"') << targets[i].first << Global.palette.reset_or('\"') << "; it will be retried by the next command sent to it: " << errors[i] << '\n';
+			}
+			if (failed != 0ull && failed == errors.size())
+				throw make_exception("Failed to open a session with any of the ", failed, " hosts!");
+		}
+
+		/// @brief	Get the name of the active session's host.
+		const std::string& active_name() const { return sessions[active].first; }
+
+		/**
+		 * @brief		Make a session active.
+		 * @param name	The host's name.
+		 * @returns		bool	false when there is no session with that name.
+		 */
+		bool use(const std::string& name)
+		{
+			for (size_t i{ 0ull }; i < sessions.size(); ++i) {
+				if (sessions[i].first == name) {
+					active = i;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/**
+		 * @brief			Execute a command on the active session & print the tagged response.
+		 * @param command	The command to execute.
+		 * @returns			bool	true when the server responded.
+		 */
+		bool send(const std::string& command)
+		{
+			std::string out;
+			const bool ok{ run(active, command, out) };
+			(std::cout << out).flush();
+			return ok;
+		}
+
+		/**
+		 * @brief			Execute a command on every session concurrently, then print the tagged responses in order.
+		 * @param command	The command to execute.
+		 * @returns			size_t	Number of sessions that responded.
+		 */
+		size_t broadcast(const std::string& command)
+		{
+			std::vector<std::string> outputs(sessions.size());
+			std::vector<char> results(sessions.size(), 0);
+			std::vector<std::thread> threads;
+			threads.reserve(sessions.size());
+			for (size_t i{ 0ull }; i < sessions.size(); ++i)
+				threads.emplace_back([&, i]() { results[i] = static_cast<char>(run(i, command, outputs[i])); });
+			for (auto& thread : threads)
+				thread.join();
+
+			size_t count{ 0ull };
+			for (size_t i{ 0ull }; i < sessions.size(); ++i) {
+				std::cout << outputs[i];
+				count += static_cast<size_t>(results[i]);
+			}
+			std::cout.flush();
+			return count;
+		}
+
+		/// @brief	Print the name & status of every session.
+		void print_hosts() const
+		{
+			for (size_t i{ 0ull }; i < sessions.size(); ++i) {
+				std::cout
+					<< (i == active ? "* " : "  ")
+					<< Global.palette.set(Color::YELLOW) << sessions[i].first << Global.palette.reset()
+					<< (sessions[i].second.is_open() ? "" : "  (disconnected)") << '\n';
+			}
+			std::cout.flush();
+		}
+
+		/**
+		 * @brief		Get the names of every host that start with a prefix.
+		 * @param word	The prefix.
+		 * @returns		std::vector<std::string>
+		 */
+		std::vector<std::string> complete_name(const std::string& word) const
+		{
+			std::vector<std::string> names;
+			for (const auto& [name, _] : sessions)
+				if (name.starts_with(word))
+					names.emplace_back(name);
+			return names;
+		}
+	};
+
+	/**
+	 * @brief			Run commands on several hosts, then open an interactive shell that can switch between them.
+	 *\n				Lines beginning with ':' are meta-commands:
+	 *\n				  :use <host>	Make "<host>" the target of subsequent commands.
+	 *\n				  :all <line>	Send "<line>" to every host.
+	 *\n				  :hosts		List the hosts & show which one is active.
+	 * @param targets		Pairs of target names & connection information.
+	 * @param commands		Commands to send to every host before the shell opens. Directives are skipped.
+	 * @param interactive	When true, the interactive shell is opened after running the commands.
+	 */
+	inline void multi(const std::vector<std::pair<std::string, net::HostInfo>>& targets, const std::vector<std::string>& commands, const bool& interactive)
+	{
+		MultiSession sessions{ targets };
+
+		for (const auto& line : commands) {
+			if (!line.empty() && !script::is_directive(line)) {
+				const auto cmd{ script::unescape(line) };
+				if (!Global.quiet && !Global.no_prompt)
+					std::cout << Global.custom_prompt << Global.palette.set(Color::GREEN) << cmd << Global.palette.reset() << '\n';
+				sessions.broadcast(cmd);
+				std::this_thread::sleep_for(Global.command_delay.load());
+			}
+		}
+		if (!interactive)
+			return;
+
+	#ifdef OS_WIN
+		if (!SetConsoleCtrlHandler(sighandler, TRUE))
+			throw make_exception("Failed to install Windows Control+C handler!");
+	#else
+		struct sigaction action {};
+		action.sa_handler = sighandler;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = 0;
+		sigaction(SIGINT, &action, nullptr);
+	#endif
+		Global.connected = true;
+
+		if (!Global.no_prompt) {
+			std::cout << "Connected to " << targets.size() << " hosts. Use \":use <host>\" to switch hosts, \":all <command>\" to send a command to every host, & \":hosts\" to list them.\nUse <Ctrl + C> ";
+			if (Global.allow_exit)
+				std::cout << "or type \"exit\" ";
+			std::cout << "to quit.\n";
+		}
+
+		const LineEditor editor{ [&sessions](const std::string& word, const size_t& index) {
+			return index == 1ull ? sessions.complete_name(word) : std::vector<std::string>{};
+		} };
+
+		while (Global.connected) {
+			const auto prompt{ Global.no_prompt ? std::string{} : str::stringify(Global.palette.set(Color::GREEN), "RCON@", sessions.active_name(), Global.palette.reset(Color::GREEN), '>', Global.palette.reset(), ' ') };
+			(std::cout << prompt).flush();
+
+			std::string line;
+			if (!editor.read(prompt, line, [] { return Global.connected.load(); }))
+				break;
+			if (Global.allow_exit && line == "exit")
+				break;
+			if (line.empty()) {
+				std::cerr << Global.palette.set(Color::BLUE) << "[not sent: empty]" << Global.palette.reset() << '\n';
+				continue;
+			}
+
+			if (line.front() != ':')
+				sessions.send(line);
+			else if (line.starts_with(":use ")) {
+				if (const auto name{ str::strip_line(line.substr(5ull)) }; !sessions.use(name))
+					std::cerr << Global.palette.get_error() << "There is no session named \"" << name << "\"!" << '\n';
+			}
+			else if (line.starts_with(":all "))
+				sessions.broadcast(line.substr(5ull));
+			else if (line == ":hosts")
+				sessions.print_hosts();
+			else std::cerr << Global.palette.get_error() << "Unknown meta-command \"" << line << "\"; expected \":use <host>\", \":all <command>\", or \":hosts\"." << '\n';
+		}
+		(std::cout << Global.palette.reset()).flush();
+	}
+}
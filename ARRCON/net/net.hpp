@@ -28,6 +28,8 @@
  */
 #pragma once
 #include "objects/packet.hpp"
+#include "recorder.hpp"
+#include "probes.hpp"
 #include "../exceptions.hpp"
 
 #include <make_exception.hpp>
@@ -59,6 +61,15 @@ namespace net {
 		return{ 0L, static_cast<long>(static_cast<double>(ms.count()) * 1000L) };
 	}
 #	define SELECT(nfds, rd, wr, ex, timeout) select(nfds, rd, wr, ex, timeout)
+	/**
+	 * @brief		Convert a std::chrono millisecond duration to a timeval struct, splitting it into seconds & microseconds.
+	 * @param ms	Duration in milliseconds
+	 * @returns		timeval
+	 */
+	inline timeval make_exact_timeout(const std::chrono::milliseconds& ms)
+	{
+		return{ static_cast<long>(ms.count() / 1000), static_cast<long>((ms.count() % 1000) * 1000L) };
+	}
 	/// @brief	Returns the last reported socket error code.
 #	define LAST_SOCKET_ERROR_CODE() (WSAGetLastError())
 #	else // POSIX
@@ -72,6 +83,17 @@ namespace net {
 		return{ 0L, static_cast<long>(static_cast<double>(ms.count()) * 1000L) };
 	}
 #	define SELECT(nfds, rd, wr, ex, timeout) pselect(nfds, rd, wr, ex, timeout, nullptr)
+	/**
+	 * @brief		Convert a std::chrono millisecond duration to a timespec struct, splitting it into seconds & nanoseconds.
+	 *\n			make_timeout() scales the configurable select timeout the same way on every platform, which
+	 *\n			existing timing settings rely on; this is used for fixed waits that must be exact.
+	 * @param ms	Duration in milliseconds
+	 * @returns		timespec
+	 */
+	inline timespec make_exact_timeout(const std::chrono::milliseconds& ms)
+	{
+		return{ static_cast<time_t>(ms.count() / 1000), static_cast<long>((ms.count() % 1000) * 1000000L) };
+	}
 	/// @brief	Returns the last reported socket error code.
 #	define LAST_SOCKET_ERROR_CODE() (errno)
 #	endif // #ifdef OS_WIN
@@ -136,6 +158,8 @@ namespace net {
 #		ifdef _WIN32
 		closesocket(sd);
 		WSACleanup();
+#		else
+		::close(static_cast<int>(sd));
 #		endif
 	}
 
@@ -156,6 +180,7 @@ namespace net {
 	*/
 	inline SOCKET connect(const std::string& host, const std::string& port)
 	{
+		ARRCON_PROBE2(connect__begin, host.c_str(), port.c_str());
 		SOCKET sd;
 
 		struct addrinfo* server_info, * p;
@@ -193,6 +218,60 @@ namespace net {
 		if (p == NULL)
 			throw connection_exception("net::connect()", "Connection Failed.", host, port, LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage());
 
+		flight::ring.push(flight::Event::CONNECT, 0, 0, static_cast<int32_t>(sd));
+		if (record::recorder.is_open())
+			record::recorder.begin(static_cast<int64_t>(sd));
+		ARRCON_PROBE1(connect__end, static_cast<int64_t>(sd));
+		return sd;
+	}
+
+	/**
+	 * @brief			Create a listening socket bound to the specified address & port.
+	 * @param host		Local address to bind to, or an empty string to bind to all interfaces.
+	 * @param port		Local port to bind to.
+	 * @param backlog	Maximum length of the pending connection queue.
+	 * @throws except	Name resolution/binding failed.
+	 * @returns			SOCKET
+	 */
+	inline SOCKET listen(const std::string& host, const std::string& port, const int& backlog = 16)
+	{
+		SOCKET sd{ static_cast<SOCKET>(SOCKET_ERROR) };
+
+		struct addrinfo* server_info, * p;
+
+		struct addrinfo hints;
+		memset(&hints, 0, sizeof hints);
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_protocol = IPPROTO_TCP;
+		hints.ai_flags = AI_PASSIVE;
+
+		net::init();
+
+		if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &server_info) != 0)
+			throw connection_exception("net::listen()", "Name resolution failed!", host, port, LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage());
+
+		for (p = server_info; p != NULL; p = p->ai_next) {
+			sd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+
+			if (sd == static_cast<SOCKET>(-1))
+				continue;
+
+			const int reuse{ 1 };
+			setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+			if (::bind(sd, p->ai_addr, static_cast<int>(p->ai_addrlen)) == SOCKET_ERROR || ::listen(sd, backlog) == SOCKET_ERROR) {
+				close_socket(sd);
+				continue;
+			}
+			break; // bound successfully, break from loop
+		}
+
+		freeaddrinfo(server_info); // release address info memory
+
+		if (p == NULL)
+			throw connection_exception("net::listen()", "Failed to bind the listening socket.", host, port, LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage());
+
 		return sd;
 	}
 
@@ -206,6 +285,7 @@ namespace net {
 	 */
 	inline bool send_packet(const SOCKET& sd, const packet::Packet& packet)
 	{
+		ARRCON_PROBE2(send__begin, packet.id, packet.size);
 		int len;
 		int total = 0;	// bytes we've sent
 		int bytesleft;	// bytes left to send 
@@ -224,6 +304,11 @@ namespace net {
 			bytesleft -= ret;
 		}
 
+		flight::ring.push(flight::Event::SEND, packet.id, packet.size, ret);
+		ARRCON_PROBE2(send__end, packet.id, ret);
+		if (ret != -1)
+			record::recorder.write(static_cast<int64_t>(sd), record::Direction::SENT, packet);
+
 		return ret != -1;
 	}
 
@@ -238,13 +323,13 @@ namespace net {
 		FD_ZERO(&set);
 		FD_SET(sd, &set);
 
-		const auto timeout{ make_timeout(Global.select_timeout) };
+		const auto timeout{ make_timeout(Global.select_timeout.load()) };
 		if (do_check_first && SELECT(sd + 1ull, &set, nullptr, nullptr, &timeout) != 1)
 			return;
 		do {
 			if (recv(sd, std::unique_ptr<char>{}.get(), packet::PSIZE_MAX, 0) == 0ul)
 				throw socket_exception("net::flush()", "Connection Lost!", LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage());
-			std::this_thread::sleep_for(Global.receive_delay);
+			std::this_thread::sleep_for(Global.receive_delay.load());
 		} while (SELECT(sd + 1ull, &set, nullptr, nullptr, &timeout) == 1);
 	}
 
@@ -255,6 +340,7 @@ namespace net {
 	 */
 	inline packet::Packet recv_packet(const SOCKET& sd)
 	{
+		ARRCON_PROBE1(recv__begin, static_cast<int64_t>(sd));
 		int psize{ 0 };
 		ssize_t ret{ recv(sd, (char*)&psize, sizeof(int), 0) };
 
@@ -270,9 +356,12 @@ namespace net {
 			default: // invalid size
 				throw socket_exception("net::recv_packet()", "Received a corrupted packet!", LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage());
 			}
-			if (psize < packet::PSIZE_MIN)
+			if (psize < packet::PSIZE_MIN) {
+				flight::record_and_dump(flight::Event::BAD_SIZE, 0, psize);
 				std::cerr << "Received unexpectedly small packet size: " << psize << std::endl;
+			}
 			else if (psize > packet::PSIZE_MAX) {
+				flight::record_and_dump(flight::Event::BAD_SIZE, 0, psize);
 				std::cerr << "Received unexpectedly large packet size: " << psize << std::endl;
 				flush(sd); // flush the remaining data
 			}
@@ -286,7 +375,11 @@ namespace net {
 			validate();
 		}
 
-		return { spacket };
+		packet::Packet packet{ spacket };
+		flight::ring.push(flight::Event::RECV, packet.id, packet.size);
+		ARRCON_PROBE2(recv__end, packet.id, packet.size);
+		record::recorder.write(static_cast<int64_t>(sd), record::Direction::RECEIVED, packet);
+		return packet;
 	}
 
 	inline std::chrono::milliseconds wait_for_packet(const SOCKET& sd, std::chrono::milliseconds const& maxTime)
@@ -295,7 +388,7 @@ namespace net {
 		FD_ZERO(&set);
 		FD_SET(sd, &set);
 
-		const auto timeout{ make_timeout(Global.select_timeout) };
+		const auto timeout{ make_timeout(Global.select_timeout.load()) };
 		const auto t0{ std::chrono::steady_clock::now() };
 		for (auto elapsed{ t0 - std::chrono::steady_clock::now() }; elapsed < maxTime; elapsed = t0 - std::chrono::steady_clock::now()) {
 			if (SELECT(sd + 1ull, &set, nullptr, nullptr, &timeout) == 1) {
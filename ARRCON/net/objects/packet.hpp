@@ -7,6 +7,7 @@
 #include <ostream>
 #include <limits.h>
 #include <string.h>
+#include <atomic>
 
 #include <var.hpp>
 
@@ -169,7 +170,7 @@ namespace net::packet {
 	static struct {
 	private:
 		/// @brief Tracks the last used packet ID number.
-		int _current_id{ PID_MIN };
+		std::atomic<int> _current_id{ PID_MIN };
 
 	public:
 		/**
@@ -179,11 +180,13 @@ namespace net::packet {
 		 *\n		of responses per request is smaller than (INT_MAX / 2).
 		 * @returns	int
 		 */
-		constexpr int get()
+		int get()
 		{
-			if (_current_id + 1 < PID_MAX) // if id is in range, increment it and return
-				return ++_current_id;
-			return _current_id = PID_MIN; // else, loop id back to the minimum bound of the valid ID range
+			int current{ _current_id.load(std::memory_order_relaxed) }, next;
+			do {
+				next = (current + 1 < PID_MAX) ? current + 1 : PID_MIN; // if id is in range, increment it; else, loop id back to the minimum bound of the valid ID range
+			} while (!_current_id.compare_exchange_weak(current, next, std::memory_order_relaxed));
+			return next;
 		}
 	} ID_Manager;
 }
\ No newline at end of file
@@ -0,0 +1,552 @@
+/**
+ * @file	pool.hpp
+ * @author	radj307
+ * @brief	Contains the HostPool object, a set of worker threads that each own an authenticated session to the same host,
+ *\n		and the PoolRegistry, which creates pools for saved hosts on demand. Used by long-running service modes.
+ *\n		When the registry has shards, each pool's sessions are driven by a Shard's event loop instead of its own threads.
+ */
+#pragma once
+#include "result.hpp"
+#include "session.hpp"
+#include "shard.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace net {
+	/**
+	 * @class	HostPool
+	 * @brief	Executes commands on a host using a fixed number of worker threads, each of which owns a session.
+	 *\n		Sessions are opened when they're first needed, & reopened after errors.
+	 *\n		Commands are queued in priority lanes; whenever a worker is free to send, it takes the oldest command from the
+	 *\n		highest non-empty lane, so high-priority commands overtake every queued lower-priority command.
+	 *\n		Read-only commands (see is_coalescable) that are identical to one already queued or in flight in the same lane
+	 *\n		aren't sent again; the response to the first one is given to every caller.
+	 *\n		A pool may instead be assigned to a Shard, which then owns its queue & sessions; the pool only forwards to it.
+	 */
+	class HostPool {
+		struct Job {
+			std::string command;
+			std::promise<CommandResult> promise;
+			std::chrono::steady_clock::time_point submitted;
+			Priority priority{ Priority::NORMAL };
+			/// @brief	When true, other callers may be waiting for this job's result in HostPool::inflight.
+			bool coalesced{ false };
+		};
+
+		/// @brief	A caller waiting for the result of an identical job.
+		struct Waiter {
+			std::promise<CommandResult> promise;
+			std::chrono::steady_clock::time_point submitted;
+		};
+
+		/// @brief	Shared with the pool's shard, if it has one. Replaced rather than modified when the target changes.
+		std::shared_ptr<const HostInfo> target;
+		size_t size;
+		/// @brief	The shard that executes the pool's commands, or nullptr when the pool has its own worker threads.
+		Shard* shard{ nullptr };
+		size_t slot{ 0ull };
+		/// @brief	Incremented when the target changes, so that workers know to reopen their sessions.
+		size_t generation{ 1ull };
+
+		mutable std::mutex mtx;
+		PoolMetrics metrics;
+
+		/**
+		 * @struct	Workers
+		 * @brief	State that is only used when the pool has its own worker threads, guarded by the pool's mutex.
+		 *\n		Pools driven by a shard don't allocate it, since there may be thousands of them.
+		 */
+		struct Workers {
+			std::condition_variable cv;
+			std::array<std::list<Job>, PRIORITY_COUNT> lanes;
+			size_t queued{ 0ull };
+			std::map<std::pair<Priority, std::string>, std::vector<Waiter>> inflight;
+			bool stop{ false };
+			/// @brief	When true, workers give their open sessions' sockets to released instead of closing them.
+			bool releasing{ false };
+			std::vector<SOCKET> released;
+			std::vector<std::thread> threads;
+		};
+		std::unique_ptr<Workers> workers;
+
+		/// @brief	Stop the worker threads once every queued command has completed.
+		void join(const bool releasing)
+		{
+			{
+				std::scoped_lock lock(mtx);
+				workers->stop = true;
+				workers->releasing = releasing;
+			}
+			workers->cv.notify_all();
+			for (auto& thread : workers->threads)
+				if (thread.joinable())
+					thread.join();
+		}
+
+		/**
+		 * @brief			Worker thread function.
+		 * @param adopted	An authenticated socket to use for the worker's session, or SOCKET_ERROR.
+		 */
+		void work(const SOCKET adopted)
+		{
+			auto& w{ *workers };
+			Session session;
+			HostInfo session_target;
+			size_t session_generation{ 0ull };
+			if (adopted != static_cast<SOCKET>(SOCKET_ERROR)) {
+				std::scoped_lock lock(mtx);
+				session = Session{ adopted };
+				session_target = *target;
+				session_generation = generation;
+				++metrics.connected;
+			}
+			while (true) {
+				Job job;
+				{
+					std::unique_lock lock(mtx);
+					w.cv.wait(lock, [&w] { return w.stop || w.queued != 0ull; });
+					if (w.queued == 0ull)
+						break;
+					auto& lane{ *std::find_if(w.lanes.begin(), w.lanes.end(), [](auto&& l) { return !l.empty(); }) };
+					job = std::move(lane.front());
+					lane.pop_front();
+					--w.queued;
+					--metrics.lanes[static_cast<size_t>(job.priority)].queued;
+					if (session_generation != generation) {
+						session_target = *target;
+						session_generation = generation;
+						if (session.is_open()) {
+							session.close();
+							--metrics.connected;
+						}
+					}
+				}
+				const auto wait{ std::chrono::steady_clock::now() - job.submitted };
+
+				CommandResult result;
+				try {
+					if (!session.is_open()) {
+						session.open(session_target);
+						++metrics.connected;
+					}
+					// an empty command only opens the session
+					result.ok = job.command.empty() || session.exchange(job.command, [&result](const packet::Packet& p) { result.response += p.body; });
+					// a command that timed out leaves the session out of sync, so it is closed; the next job reopens it
+					if (!result.ok) {
+						session.close();
+						--metrics.connected;
+					}
+				} catch (const std::exception& ex) {
+					if (session.is_open()) {
+						session.close();
+						--metrics.connected;
+					}
+					result.error = ex.what();
+				}
+				result.latency = std::chrono::steady_clock::now() - job.submitted;
+				metrics.record(job.priority, wait, result);
+
+				if (job.coalesced) {
+					std::vector<Waiter> waiters;
+					{
+						std::scoped_lock lock(mtx);
+						const auto it{ w.inflight.find(std::make_pair(job.priority, job.command)) };
+						waiters = std::move(it->second);
+						w.inflight.erase(it);
+					}
+					for (auto& waiter : waiters) {
+						auto copy{ result };
+						copy.latency = std::chrono::steady_clock::now() - waiter.submitted;
+						waiter.promise.set_value(std::move(copy));
+					}
+				}
+				job.promise.set_value(std::move(result));
+			}
+			if (session.is_open()) {
+				--metrics.connected;
+				std::scoped_lock lock(mtx);
+				if (w.releasing)
+					w.released.emplace_back(session.release());
+			}
+		}
+
+	public:
+		/**
+		 * @brief			Start the worker threads.
+		 * @param target	The host's connection information.
+		 * @param size		Number of worker threads & sessions.
+		 * @param adopted	Sockets that are already connected & authenticated with the target, such as ones received from
+		 *\n				another process during an upgrade. Each worker uses one instead of opening a session; extras are closed.
+		 */
+		HostPool(std::shared_ptr<const HostInfo> target, const size_t& size, const std::vector<SOCKET>& adopted = {}) : target{ std::move(target) }, size{ size }, workers{ std::make_unique<Workers>() }
+		{
+			workers->threads.reserve(size);
+			for (size_t i{ 0ull }; i < size; ++i)
+				workers->threads.emplace_back(&HostPool::work, this, i < adopted.size() ? adopted[i] : static_cast<SOCKET>(SOCKET_ERROR));
+			for (size_t i{ size }; i < adopted.size(); ++i)
+				close_socket(adopted[i]);
+		}
+		/**
+		 * @brief			Assign the pool to a shard, which opens sessions as they're needed.
+		 * @param target	The host's connection information.
+		 * @param size		Maximum number of sessions.
+		 * @param shard		The shard.
+		 */
+		HostPool(std::shared_ptr<const HostInfo> target, const size_t& size, Shard& shard) : target{ std::move(target) }, size{ size }, shard{ &shard }
+		{
+			slot = shard.add(this->target, size, metrics);
+		}
+		HostPool(const HostPool&) = delete;
+		HostPool& operator=(const HostPool&) = delete;
+		/// @brief	Finish every queued command, then stop the worker threads.
+		~HostPool()
+		{
+			if (shard != nullptr) {
+				if (slot != 0ull)
+					shard->remove(slot);
+				return;
+			}
+			join(false);
+		}
+
+		/**
+		 * @brief	Finish every queued command, then stop the worker threads without closing their sessions.
+		 *\n		The pool can't be used afterwards. Sessions owned by a shard are closed instead.
+		 * @returns	std::vector<SOCKET>	The sockets of every open session. The caller is responsible for closing them.
+		 */
+		std::vector<SOCKET> release()
+		{
+			if (shard != nullptr) {
+				shard->remove(std::exchange(slot, 0ull));
+				return {};
+			}
+			join(true);
+			return std::move(workers->released);
+		}
+
+		/// @brief	Get the host's connection information.
+		HostInfo get_target() const
+		{
+			std::scoped_lock lock(mtx);
+			return *target;
+		}
+
+		/**
+		 * @brief			Change the host's connection information.
+		 *\n				Each worker finishes its current command, then reconnects to the new target before its next one.
+		 * @param info		The new connection information.
+		 */
+		void retarget(std::shared_ptr<const HostInfo> info)
+		{
+			std::scoped_lock lock(mtx);
+			target = std::move(info);
+			++generation;
+			if (shard != nullptr)
+				shard->retarget(slot, target);
+		}
+
+		/**
+		 * @brief			Queue a command to be executed by the next available worker.
+		 * @param command	The command to execute. When empty, the worker only opens its session; this can be used to
+		 *\n				check that the host is reachable & the password is correct.
+		 * @param priority	The lane to queue the command in.
+		 * @returns			std::future<CommandResult>
+		 */
+		std::future<CommandResult> submit(std::string command, const Priority priority = Priority::NORMAL)
+		{
+			if (shard != nullptr)
+				return shard->submit(slot, std::move(command), priority, metrics);
+			const auto now{ std::chrono::steady_clock::now() };
+			const bool coalescable{ is_coalescable(command) };
+			Job job{ std::move(command), {}, now, priority, coalescable };
+			auto future{ job.promise.get_future() };
+			{
+				std::scoped_lock lock(mtx);
+				if (coalescable) {
+					if (const auto [it, added] { workers->inflight.try_emplace(std::make_pair(priority, job.command)) }; !added) {
+						// an identical command is already queued or in flight; wait for its result instead
+						++metrics.coalesced;
+						auto& waiter{ it->second.emplace_back(Waiter{ {}, now }) };
+						return waiter.promise.get_future();
+					}
+				}
+				workers->lanes[static_cast<size_t>(priority)].emplace_back(std::move(job));
+				++workers->queued;
+				++metrics.lanes[static_cast<size_t>(priority)].queued;
+			}
+			workers->cv.notify_one();
+			return future;
+		}
+
+		/**
+		 * @struct	LaneStatus
+		 * @brief	A snapshot of a priority lane's state.
+		 */
+		struct LaneStatus {
+			size_t queued, completed;
+			/// @brief	Mean time that commands waited in the queue before being sent.
+			std::chrono::nanoseconds mean_wait;
+			/// @brief	Mean & maximum time from when commands were submitted until their responses were received.
+			std::chrono::nanoseconds mean_latency, max_latency;
+		};
+		/**
+		 * @struct	Status
+		 * @brief	A snapshot of a pool's state.
+		 */
+		struct Status {
+			size_t sessions, connected, queued, completed, errors;
+			/// @brief	Number of commands that were answered by an identical in-flight command instead of being sent.
+			size_t coalesced;
+			std::array<LaneStatus, PRIORITY_COUNT> lanes;
+		};
+
+		/// @brief	Get a snapshot of the pool's state.
+		Status status() const
+		{
+			Status status{ size, metrics.connected.load(), 0ull, metrics.completed.load(), metrics.errors.load(), metrics.coalesced.load(), {} };
+			for (size_t i{ 0ull }; i < PRIORITY_COUNT; ++i) {
+				auto& lane{ status.lanes[i] };
+				const auto& lane_metrics{ metrics.lanes[i] };
+				lane.queued = lane_metrics.queued.load();
+				status.queued += lane.queued;
+				lane.completed = lane_metrics.completed.load();
+				const auto count{ lane.completed == 0ull ? 1ull : lane.completed };
+				lane.mean_wait = std::chrono::nanoseconds{ lane_metrics.total_wait.load() / count };
+				lane.mean_latency = std::chrono::nanoseconds{ lane_metrics.total_latency.load() / count };
+				lane.max_latency = std::chrono::nanoseconds{ lane_metrics.max_latency.load() };
+			}
+			return status;
+		}
+	};
+
+	/**
+	 * @brief		Convert the metrics of every priority lane to a JSON object whose members are the lanes' names.
+	 * @param lanes	The lanes' metrics.
+	 * @returns		std::string
+	 */
+	inline std::string to_json(const std::array<HostPool::LaneStatus, PRIORITY_COUNT>& lanes)
+	{
+		json::Object obj;
+		for (size_t i{ 0ull }; i < PRIORITY_COUNT; ++i) {
+			const auto& lane{ lanes[i] };
+			obj.add_raw(to_string(static_cast<Priority>(i)), json::Object{}
+				.add("queued", lane.queued)
+				.add("completed", lane.completed)
+				.add("mean_wait_ms", std::chrono::duration<double, std::milli>(lane.mean_wait).count())
+				.add("mean_latency_ms", std::chrono::duration<double, std::milli>(lane.mean_latency).count())
+				.add("max_latency_ms", std::chrono::duration<double, std::milli>(lane.max_latency).count())
+				.str());
+		}
+		return obj.str();
+	}
+
+	/**
+	 * @struct	PooledSocket
+	 * @brief	An authenticated socket released from a HostPool, & the host that it is connected to.
+	 */
+	struct PooledSocket {
+		std::string name;
+		HostInfo target;
+		SOCKET sd;
+	};
+
+	/**
+	 * @class	PoolRegistry
+	 * @brief	Creates a HostPool for each named host the first time it is used.
+	 *\n		When shards are used, each host is assigned to a shard by hashing its name, so a host's commands are always
+	 *\n		executed by the same thread.
+	 */
+	class PoolRegistry {
+		/// @brief	Each host's connection information is shared with its pool, rather than copied.
+		std::map<std::string, std::shared_ptr<const HostInfo>> targets;
+		size_t pool_size;
+
+		/// @brief	Declared before the pools so that the pools are removed from their shards before the shards stop.
+		std::vector<std::unique_ptr<Shard>> shards;
+		mutable std::mutex mtx;
+		std::map<std::string, std::unique_ptr<HostPool>> pools;
+		/// @brief	Host names, which refer to the keys of pools, & their pools, sorted by name.
+		using Snapshot = std::vector<std::pair<std::string_view, HostPool*>>;
+		/**
+		 * @brief	Immutable list of the pools that get() returns, replaced whenever a pool is created or a host changes.
+		 *\n		Lets get() find existing pools without locking the mutex.
+		 */
+		std::atomic<std::shared_ptr<const Snapshot>> snapshot{ std::make_shared<const Snapshot>() };
+
+		/// @brief	Replace the snapshot with the pools of every current host. The caller must hold the mutex.
+		void publish()
+		{
+			auto updated{ std::make_shared<Snapshot>() };
+			updated->reserve(pools.size());
+			for (const auto& [name, pool] : pools)
+				if (targets.contains(name))
+					updated->emplace_back(name, pool.get());
+			snapshot.store(std::move(updated), std::memory_order_release);
+		}
+
+		/// @brief	Convert a map of host names to their connection information to the form used by the registry.
+		static std::map<std::string, std::shared_ptr<const HostInfo>> share(std::map<std::string, HostInfo> map)
+		{
+			std::map<std::string, std::shared_ptr<const HostInfo>> shared;
+			for (auto& [name, info] : map)
+				shared.emplace(name, std::make_shared<const HostInfo>(std::move(info)));
+			return shared;
+		}
+
+		/// @brief	Create a pool for a host.
+		std::unique_ptr<HostPool> make_pool(const std::string& name, const std::shared_ptr<const HostInfo>& target, const std::vector<SOCKET>& adopted = {}) const
+		{
+			if (shards.empty())
+				return std::make_unique<HostPool>(target, pool_size, adopted);
+			for (const auto& sd : adopted)
+				close_socket(sd);
+			return std::make_unique<HostPool>(target, pool_size, *shards[std::hash<std::string>{}(name) % shards.size()]);
+		}
+
+	public:
+		/**
+		 * @brief			Constructor.
+		 * @param targets	Map of host names to their connection information.
+		 * @param pool_size	Number of sessions in each pool.
+		 * @param shards	Number of shards that execute every pool's commands, or 0 to give each pool its own threads.
+		 */
+		PoolRegistry(std::map<std::string, HostInfo> targets, const size_t& pool_size, const size_t& shards = 0ull) : targets{ share(std::move(targets)) }, pool_size{ pool_size == 0ull ? 1ull : pool_size }
+		{
+			this->shards.reserve(shards);
+			for (size_t i{ 0ull }; i < shards; ++i)
+				this->shards.emplace_back(std::make_unique<Shard>());
+		}
+
+		/**
+		 * @brief		Get the pool for a host, creating it if necessary.
+		 *\n			Existing pools are found without locking, so callers on every thread can use this for each command.
+		 * @param name	The host's name.
+		 * @returns		HostPool*
+		 *\n			nullptr when there is no host with that name.
+		 */
+		HostPool* get(const std::string& name)
+		{
+			const auto current{ snapshot.load(std::memory_order_acquire) };
+			if (const auto it{ std::lower_bound(current->begin(), current->end(), name, [](auto&& entry, auto&& key) { return entry.first < key; }) }; it != current->end() && it->first == name)
+				return it->second;
+
+			std::scoped_lock lock(mtx);
+			const auto target{ targets.find(name) };
+			if (target == targets.end())
+				return nullptr;
+			if (const auto it{ pools.find(name) }; it != pools.end())
+				return it->second.get();
+			auto* pool{ pools.emplace(name, make_pool(name, target->second)).first->second.get() };
+			publish();
+			return pool;
+		}
+
+		/**
+		 * @brief			Replace the map of host names to their connection information.
+		 *\n				Pools of hosts whose connection information changed are retargeted; every other session stays open.
+		 *\n				Pools of removed hosts are kept until the registry is destroyed, since they may still be in use,
+		 *\n				but get() no longer returns them.
+		 * @param updated	The new map of host names to their connection information.
+		 * @returns			size_t	Number of existing pools that were retargeted.
+		 */
+		size_t update(std::map<std::string, HostInfo> updated)
+		{
+			std::scoped_lock lock(mtx);
+			size_t count{ 0ull };
+			std::map<std::string, std::shared_ptr<const HostInfo>> shared;
+			for (auto& [name, info] : updated) {
+				if (const auto it{ targets.find(name) }; it != targets.end() && *it->second == info) {
+					shared.emplace(name, it->second);
+					continue;
+				}
+				const auto& target{ shared.emplace(name, std::make_shared<const HostInfo>(std::move(info))).first->second };
+				if (const auto it{ pools.find(name) }; it != pools.end()) {
+					it->second->retarget(target);
+					++count;
+				}
+			}
+			targets = std::move(shared);
+			publish();
+			return count;
+		}
+
+		/**
+		 * @brief			Create pools that use sockets released by another registry, such as one in another process.
+		 *\n				Sockets are only used when their host still exists & its connection information is unchanged;
+		 *\n				the rest are closed. Shards open their own sessions, so every socket is closed when shards are used.
+		 * @param sockets	The released sockets.
+		 * @returns			size_t	Number of sockets that were adopted.
+		 */
+		size_t adopt(const std::vector<PooledSocket>& sockets)
+		{
+			std::scoped_lock lock(mtx);
+			std::map<std::string, std::vector<SOCKET>> usable;
+			for (const auto& socket : sockets) {
+				if (const auto it{ targets.find(socket.name) }; it != targets.end() && *it->second == socket.target && !pools.contains(socket.name))
+					usable[socket.name].emplace_back(socket.sd);
+				else close_socket(socket.sd);
+			}
+
+			size_t count{ 0ull };
+			for (const auto& [name, sds] : usable) {
+				pools.emplace(name, make_pool(name, targets.at(name), sds));
+				if (shards.empty())
+					count += std::min(sds.size(), pool_size);
+			}
+			publish();
+			return count;
+		}
+
+		/**
+		 * @brief	Finish every queued command in every pool, then stop the pools without closing their sessions.
+		 *\n		Pools are created again as needed if the registry is used afterwards.
+		 * @returns	std::vector<PooledSocket>	The sockets of every open session. The caller is responsible for closing them.
+		 */
+		std::vector<PooledSocket> release()
+		{
+			std::scoped_lock lock(mtx);
+			std::vector<PooledSocket> sockets;
+			for (auto& [name, pool] : pools) {
+				const auto target{ pool->get_target() };
+				for (const auto& sd : pool->release())
+					sockets.emplace_back(PooledSocket{ name, target, sd });
+			}
+			pools.clear();
+			publish();
+			return sockets;
+		}
+
+		/// @brief	Check if a host exists.
+		bool contains(const std::string& name) const
+		{
+			std::scoped_lock lock(mtx);
+			return targets.contains(name);
+		}
+
+		/// @brief	Get the names of every host.
+		std::vector<std::string> names() const
+		{
+			std::scoped_lock lock(mtx);
+			std::vector<std::string> vec;
+			vec.reserve(targets.size());
+			for (const auto& [name, _] : targets)
+				vec.emplace_back(name);
+			return vec;
+		}
+	};
+}
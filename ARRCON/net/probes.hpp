@@ -0,0 +1,34 @@
+/**
+ * @file	probes.hpp
+ * @author	radj307
+ * @brief	Contains the USDT (SystemTap/DTrace) static probe macros used on the networking hot path.
+ *\n		Probes compile to a single nop when nothing is attached, and to nothing at all when
+ *\n		ARRCON_ENABLE_USDT is not defined or <sys/sdt.h> isn't available.
+ *\n
+ *\n		Available probes (provider "arrcon"):
+ *\n		  connect__begin(host, port)		connect__end(sd)
+ *\n		  auth__begin(id)					auth__end(id, success)
+ *\n		  send__begin(id, size)				send__end(id, result)
+ *\n		  recv__begin(sd)					recv__end(id, size)
+ *\n		  command__begin(id, command)		command__end(id, packet_count, success)
+ *\n
+ *\n		Example:  bpftrace -e 'usdt:./ARRCON:arrcon:command__end { @[arg2] = count(); }'
+ */
+#pragma once
+
+#if defined(ARRCON_ENABLE_USDT) && defined(__has_include)
+#	if __has_include(<sys/sdt.h>)
+#		include <sys/sdt.h>
+#		define ARRCON_HAS_USDT
+#	endif
+#endif
+
+#ifdef ARRCON_HAS_USDT
+#	define ARRCON_PROBE1(name, a)			DTRACE_PROBE1(arrcon, name, a)
+#	define ARRCON_PROBE2(name, a, b)		DTRACE_PROBE2(arrcon, name, a, b)
+#	define ARRCON_PROBE3(name, a, b, c)		DTRACE_PROBE3(arrcon, name, a, b, c)
+#else
+#	define ARRCON_PROBE1(name, a)			do {} while (0)
+#	define ARRCON_PROBE2(name, a, b)		do {} while (0)
+#	define ARRCON_PROBE3(name, a, b, c)		do {} while (0)
+#endif
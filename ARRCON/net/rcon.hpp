@@ -7,6 +7,7 @@
 #pragma once
 #include "net.hpp"
 #include "../packet-color.hpp"
+#include "feed.hpp"
 
 #define PERMISSIVE_AUTHENTICATION true
 
@@ -15,6 +16,26 @@
   * @brief		Contains functions used to interact with the RCON server.
   */
 namespace net::rcon {
+	/**
+	 * @brief			Check whether a password may be used to authenticate, which isn't the case for blank passwords unless bAllowBlankPassword is set.
+	 * @param pass		RCON Password.
+	 * @returns			bool
+	 */
+	inline bool password_allowed(const std::string& pass)
+	{
+		return Global.allowBlankPassword || !pass.empty();
+	}
+	/**
+	 * @brief			Throw an exception when a target's password isn't allowed. See password_allowed().
+	 * @param host		Hostname of the target, for the error message.
+	 * @param port		Port of the target, for the error message.
+	 * @param pass		RCON Password.
+	 */
+	inline void require_password(const std::string& host, const std::string& port, const std::string& pass)
+	{
+		if (!password_allowed(pass))
+			throw connection_exception("net::rcon::require_password()", "Password cannot be blank!", host, port, 0, "Set bAllowBlankPassword in the config to allow it.");
+	}
 	/**
 	 * @brief			Authenticate with the connected RCON server.
 	 * @param sd		Socket to use.
@@ -25,37 +46,44 @@ namespace net::rcon {
 	{
 		const auto pid{ packet::ID_Manager.get() };
 		packet::Packet packet{ pid, packet::Type::SERVERDATA_AUTH, pass };
+		ARRCON_PROBE1(auth__begin, pid);
 
 		if (net::send_packet(sd, packet)) {
 			try {
 				packet = net::recv_packet(sd);
-				return packet.id == pid || (PERMISSIVE_AUTHENTICATION && packet.id != -1);
+				const bool success{ packet.id == pid || (PERMISSIVE_AUTHENTICATION && packet.id != -1) };
+				flight::ring.push(flight::Event::AUTH, packet.id, packet.size, success);
+				ARRCON_PROBE2(auth__end, pid, static_cast<int>(success));
+				return success;
 			} catch (const socket_except&) {}
 		}
+		ARRCON_PROBE2(auth__end, pid, 0);
 		return false;
 	}
 	/**
-	 * @brief			Send a command to the connected RCON server.
+	 * @brief			Send a command to the connected RCON server, and pass each response packet to a handler function.
 	 * @param sd		Socket to use.
 	 * @param command	Command string to send.
+	 * @param handler	Function that is called with each response packet, in the order they were received.
 	 * @returns			true when the "terminator" packet was received, indicating that the message was received correctly; otherwise false, indicating that something went wrong, or the current timeout is too short.
 	 */
-	inline bool command(const SOCKET& sd, const std::string& command)
+	template<std::invocable<const packet::Packet&> Handler>
+	inline bool command(const SOCKET& sd, const std::string& command, Handler&& handler)
 	{
 		const auto pid{ packet::ID_Manager.get() };
 		int packet_count{ 0 };
+		ARRCON_PROBE2(command__begin, pid, command.c_str());
 
 		if (!net::send_packet(sd, { pid, packet::Type::SERVERDATA_EXECCOMMAND, command }))
 			throw socket_exception("rcon::command()", "Command failed, couldn't send the end-of-message detection packet!");
 
 		const auto terminator_pid{ packet::ID_Manager.get() };
 		bool wait_for_term{ false }; ///< true when terminator packet was sent successfully
-		std::this_thread::sleep_for(Global.receive_delay); ///< allow some time for the server to respond
+		std::this_thread::sleep_for(Global.receive_delay.load()); ///< allow some time for the server to respond
 
 		auto p{ net::recv_packet(sd) }; ///< receive first packet
 
-		if (!Global.quiet) // print the packet
-			std::cout << p;
+		handler(p);
 
 		packet_count += static_cast<int>(p.isValid());
 
@@ -64,10 +92,16 @@ namespace net::rcon {
 		FD_ZERO(&socket_set);
 		FD_SET(sd, &socket_set);
 
-		const auto timeout{ make_timeout(Global.select_timeout) };
+		const auto timeout{ make_timeout(Global.select_timeout.load()) };
+
+		const auto poll_socket{ [&]() {
+			const int rc{ SELECT(sd + 1ll, &socket_set, nullptr, nullptr, &timeout) };
+			flight::ring.push(flight::Event::SELECT, pid, 0, rc);
+			return rc;
+		} };
 
 		// loop while socket has pending data
-		for (size_t i{ 0ull }; SELECT(sd + 1ll, &socket_set, nullptr, nullptr, &timeout) == 1; p = net::recv_packet(sd), ++i) {
+		for (size_t i{ 0ull }; poll_socket() == 1; p = net::recv_packet(sd), ++i) {
 			if (i == 0ull && net::send_packet(sd, { terminator_pid, packet::Type::SERVERDATA_RESPONSE_VALUE, "TERM" }))
 				wait_for_term = true;
 			if (wait_for_term && p.id == terminator_pid) {
@@ -75,14 +109,82 @@ namespace net::rcon {
 					net::flush(sd, false); // flush any remaining packets
 				break;
 			}
-			else if (!Global.quiet) {
-				std::cout << p; ///< don't print newlines automatically
+			else {
+				handler(p);
 				++packet_count;
 			}
-			std::this_thread::sleep_for(Global.receive_delay);
+			std::this_thread::sleep_for(Global.receive_delay.load());
 			p = {}; ///< wipe existing packet
 		}
-		std::cout.flush() << Global.palette.reset();; ///< flush STDOUT & reset color (interrupts before color reset call are handled by sighandler so colors don't bleed out)
-		return (p.id == terminator_pid || !wait_for_term) && packet_count > 0; // if the last received packet has the terminator's ID, or if the terminator wasn't set
+		const bool success{ (p.id == terminator_pid || !wait_for_term) && packet_count > 0 }; // if the last received packet has the terminator's ID, or if the terminator wasn't set
+		if (!success)
+			flight::record_and_dump(flight::Event::TIMEOUT, pid, 0, packet_count);
+		ARRCON_PROBE3(command__end, pid, packet_count, static_cast<int>(success));
+		return success;
+	}
+	/**
+	 * @brief			Send a command to the connected RCON server, and print the response to STDOUT.
+	 * @param sd		Socket to use.
+	 * @param command	Command string to send.
+	 * @returns			true when the "terminator" packet was received, indicating that the message was received correctly; otherwise false, indicating that something went wrong, or the current timeout is too short.
+	 */
+	inline bool command(const SOCKET& sd, const std::string& command)
+	{
+		std::string response;
+		const bool success{ net::rcon::command(sd, command, [&response](const packet::Packet& p) {
+			if (!Global.quiet)
+				std::cout << p; ///< don't print newlines automatically
+			if (feed::feed.is_open())
+				response += p.body;
+		}) };
+		std::cout.flush() << Global.palette.reset(); ///< flush STDOUT & reset color (interrupts before color reset call are handled by sighandler so colors don't bleed out)
+		feed::feed.publish_response(Global.target.hostname, command, response);
+		return success;
+	}
+
+	/**
+	 * @brief			Send a command immediately followed by a terminator packet, then receive response packets until
+	 *\n				the terminator's response arrives. Unlike command(), this doesn't rely on receive delays or
+	 *\n				select timeouts to detect the end of a response, so it completes as soon as the server responds.
+	 * @param sd		Socket to use.
+	 * @param command	Command string to send.
+	 * @param handler	Function that is called with each response packet, in the order they were received.
+	 * @param timeout	Maximum amount of time to wait for each packet.
+	 * @returns			true when the terminator's response was received; false when the timeout expired first.
+	 *\n				When false is returned, the rest of the response may still arrive, so the socket is out of sync & should
+	 *\n				be closed. Packets left over from earlier commands are ignored, since their IDs don't match.
+	 */
+	template<std::invocable<const packet::Packet&> Handler>
+	inline bool exchange(const SOCKET& sd, const std::string& command, Handler&& handler, const std::chrono::milliseconds& timeout = std::chrono::seconds{ 10 })
+	{
+		const auto pid{ packet::ID_Manager.get() };
+		const auto terminator_pid{ packet::ID_Manager.get() };
+		ARRCON_PROBE2(command__begin, pid, command.c_str());
+
+		if (!net::send_packet(sd, { pid, packet::Type::SERVERDATA_EXECCOMMAND, command }) || !net::send_packet(sd, { terminator_pid, packet::Type::SERVERDATA_RESPONSE_VALUE, "TERM" }))
+			throw socket_exception("rcon::exchange()", "Failed to send the command!", LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage());
+
+		fd_set socket_set;
+		int packet_count{ 0 };
+		for (;;) {
+			FD_ZERO(&socket_set);
+			FD_SET(sd, &socket_set);
+			const auto tm{ make_exact_timeout(timeout) };
+			if (const int rc{ SELECT(sd + 1ll, &socket_set, nullptr, nullptr, &tm) }; rc != 1) {
+				flight::record_and_dump(flight::Event::TIMEOUT, pid, 0, packet_count);
+				ARRCON_PROBE3(command__end, pid, packet_count, 0);
+				return false;
+			}
+			const auto p{ net::recv_packet(sd) };
+			if (p.id == terminator_pid)
+				break;
+			// Source servers answer the terminator with 2 packets, so the 2nd one of the previous command may still be waiting
+			if (p.id != pid)
+				continue;
+			handler(p);
+			++packet_count;
+		}
+		ARRCON_PROBE3(command__end, pid, packet_count, 1);
+		return true;
 	}
 }
@@ -0,0 +1,201 @@
+/**
+ * @file	recorder.hpp
+ * @author	radj307
+ * @brief	Contains the session recorder used by the [--record] & [--replay] options.
+ *\n
+ *\n		Recordings use a compact binary format, written in native byte order:
+ *\n		  Header:	"ARRCREC\0" (8 B), format version (uint32)
+ *\n		  Frame:	timestamp (uint64, ns since recording began, monotonic)
+ *\n					session id (uint32, see net::record::Recorder::begin)
+ *\n					direction (uint8, see net::record::Direction)
+ *\n					packet id (int32), packet type (int32)
+ *\n					body length (uint32), body (body length B)
+ */
+#pragma once
+#include "objects/packet.hpp"
+
+#include <make_exception.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+ /**
+  * @namespace	record
+  * @brief		Contains the session recording & playback objects.
+  */
+namespace net::record {
+	/// @brief	Magic number at the beginning of every recording.
+	inline constexpr const char MAGIC[8]{ 'A', 'R', 'R', 'C', 'R', 'E', 'C', '\0' };
+	/// @brief	Current recording format version.
+	inline constexpr const uint32_t VERSION{ 2u };
+
+	/**
+	 * @enum	Direction
+	 * @brief	The direction that a recorded frame was travelling in.
+	 */
+	enum class Direction : uint8_t {
+		/// @brief	Client -> Server
+		SENT = 0,
+		/// @brief	Server -> Client
+		RECEIVED = 1,
+	};
+
+	/**
+	 * @struct	Frame
+	 * @brief	A single recorded packet.
+	 */
+	struct Frame {
+		std::chrono::nanoseconds timestamp;
+		uint32_t session;
+		Direction direction;
+		packet::Packet packet;
+	};
+
+	/**
+	 * @class	Recorder
+	 * @brief	Appends every frame passed to write() to a recording file.
+	 */
+	class Recorder {
+		std::ofstream ofs;
+		std::chrono::steady_clock::time_point t0;
+		std::mutex mtx;
+		std::unordered_map<int64_t, uint32_t> sessions; ///< socket -> session id
+		uint32_t next_session{ 1u };
+
+		template<typename T>
+		void put(const T& value)
+		{
+			ofs.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+	public:
+		/**
+		 * @brief		Open a new recording, overwriting the target file if it already exists.
+		 * @param path	Location of the recording file.
+		 * @returns		bool
+		 */
+		bool open(const std::filesystem::path& path)
+		{
+			std::scoped_lock lock(mtx);
+			ofs.open(path, std::ios_base::binary | std::ios_base::trunc);
+			if (!ofs.is_open())
+				return false;
+			ofs.write(MAGIC, sizeof(MAGIC));
+			put(VERSION);
+			t0 = std::chrono::steady_clock::now();
+			sessions.clear();
+			next_session = 1u;
+			return ofs.good();
+		}
+
+		/// @brief	Check if a recording is in progress.
+		bool is_open() const { return ofs.is_open(); }
+
+		/**
+		 * @brief		Start a new session on a connected socket. Frames sent or received on it are tagged with the returned id
+		 *\n			until the socket is used by another session, so that concurrent sessions (such as the background
+		 *\n			tab-completion session) can be told apart from the primary one, which is always session 1.
+		 * @param sd	The connected socket.
+		 * @returns		uint32_t
+		 */
+		uint32_t begin(const int64_t& sd)
+		{
+			std::scoped_lock lock(mtx);
+			return sessions.insert_or_assign(sd, next_session++).first->second;
+		}
+
+		/**
+		 * @brief			Append a frame to the recording.
+		 * @param sd		The socket that the packet was sent or received on.
+		 * @param dir		The direction of the packet.
+		 * @param packet	The packet to record.
+		 */
+		void write(const int64_t& sd, const Direction& dir, const packet::Packet& packet)
+		{
+			if (!is_open())
+				return;
+			const uint32_t len{ static_cast<uint32_t>(packet.body.size()) };
+
+			std::scoped_lock lock(mtx);
+			// the timestamp is taken under the lock, so that frames are written in timestamp order
+			const uint64_t ts{ static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count()) };
+			auto it{ sessions.find(sd) };
+			if (it == sessions.end())
+				it = sessions.emplace(sd, next_session++).first;
+			put(ts);
+			put(it->second);
+			put(static_cast<uint8_t>(dir));
+			put(static_cast<int32_t>(packet.id));
+			put(static_cast<int32_t>(packet.type));
+			put(len);
+			ofs.write(packet.body.data(), len);
+		}
+
+		/// @brief	Flush & close the recording.
+		void close()
+		{
+			std::scoped_lock lock(mtx);
+			if (ofs.is_open())
+				ofs.close();
+		}
+	};
+
+	/**
+	 * @class	Reader
+	 * @brief	Reads frames from a recording file created by Recorder.
+	 */
+	class Reader {
+		std::ifstream ifs;
+
+		template<typename T>
+		bool get(T& value)
+		{
+			return static_cast<bool>(ifs.read(reinterpret_cast<char*>(&value), sizeof(T)));
+		}
+
+	public:
+		/**
+		 * @brief		Open a recording file & validate its header.
+		 * @param path	Location of the recording file.
+		 * @throws		ex::except	The file is not a valid recording.
+		 */
+		Reader(const std::filesystem::path& path) : ifs{ path, std::ios_base::binary }
+		{
+			char magic[sizeof(MAGIC)]{};
+			uint32_t version{ 0u };
+			if (!ifs.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !get(version))
+				throw make_exception("File ", path, " is not an ARRCON recording!");
+			if (version != VERSION)
+				throw make_exception("Unsupported recording format version ", version, " in file ", path, "; expected version ", VERSION, '.');
+		}
+
+		/**
+		 * @brief	Read the next frame from the recording.
+		 * @returns	std::optional<Frame>
+		 *\n		std::nullopt when the end of the recording was reached.
+		 */
+		std::optional<Frame> next()
+		{
+			uint64_t ts{};
+			uint32_t session{};
+			uint8_t dir{};
+			int32_t id{}, type{};
+			uint32_t len{};
+			if (!get(ts) || !get(session) || !get(dir) || !get(id) || !get(type) || !get(len))
+				return std::nullopt;
+			std::string body(len, '\0');
+			if (!ifs.read(body.data(), len))
+				return std::nullopt;
+			return Frame{ std::chrono::nanoseconds{ ts }, session, static_cast<Direction>(dir), packet::Packet{ id, type, body } };
+		}
+	};
+
+	/// @brief	The active session recorder, opened by the [--record] option.
+	inline Recorder recorder;
+}
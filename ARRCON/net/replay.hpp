@@ -0,0 +1,92 @@
+/**
+ * @file	replay.hpp
+ * @author	radj307
+ * @brief	Contains the replay mode, which plays back a session recording as a fake RCON server.
+ */
+#pragma once
+#include "../globals.h"
+#include "net.hpp"
+
+#include <iostream>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+namespace mode {
+	/**
+	 * @brief			Play back a session recording as a fake RCON server.
+	 *\n				Frames sent by the original client are read from the connected client instead, and
+	 *\n				frames received by the original client are sent with the same delay relative to the
+	 *\n				preceding client frame, divided by the playback speed.
+	 *\n				Packet IDs are rewritten so that responses match the IDs used by the connected client.
+	 *\n				Only the primary session is played back; frames from other sessions in the recording, such as the
+	 *\n				background tab-completion session, are skipped.
+	 * @param path		Location of the recording file.
+	 * @param host		Local address to listen on.
+	 * @param port		Local port to listen on.
+	 * @param speed		Playback speed multiplier. (1.0 is the original timing)
+	 */
+	inline void replay(const std::filesystem::path& path, const std::string& host, const std::string& port, const double& speed)
+	{
+		if (speed <= 0.0)
+			throw make_exception("Invalid replay speed ", speed, "; expected a number greater than 0.");
+
+		const SOCKET listener{ net::listen(host, port, 1) };
+
+		if (!Global.quiet)
+			std::cout << Global.palette.get_msg() << "Replaying " << path << " on " << host << ':' << port << "; waiting for a client to connect..." << std::endl;
+
+		const SOCKET sd{ static_cast<SOCKET>(::accept(listener, nullptr, nullptr)) };
+		if (sd == static_cast<SOCKET>(SOCKET_ERROR))
+			throw socket_exception("mode::replay()", "Failed to accept a client connection!", LAST_SOCKET_ERROR_CODE(), net::getLastSocketErrorMessage());
+		net::close_socket(listener);
+
+		net::record::Reader reader{ path };
+
+		std::unordered_map<int, int> id_map; ///< recorded id -> live id
+		auto anchor_time{ std::chrono::steady_clock::now() };
+		std::chrono::nanoseconds anchor_timestamp{ 0 };
+		size_t count{ 0ull }, mismatched{ 0ull }, skipped{ 0ull };
+		std::optional<uint32_t> session; ///< the session being played back
+
+		try {
+			while (const auto frame{ reader.next() }) {
+				if (!session.has_value())
+					session = frame->session;
+				else if (frame->session != session.value()) {
+					++skipped;
+					continue;
+				}
+				if (frame->direction == net::record::Direction::SENT) {
+					const auto live{ net::recv_packet(sd) };
+					if (live.body != frame->packet.body && live.type != net::packet::Type::SERVERDATA_AUTH) {
+						++mismatched;
+						if (!Global.quiet)
+							std::cerr << Global.palette.get_warn() << "Frame " << count << ": client sent \"" << live.body << "\"; recording expected \"" << frame->packet.body << "\"\n";
+					}
+					id_map.insert_or_assign(frame->packet.id, live.id);
+					anchor_time = std::chrono::steady_clock::now();
+					anchor_timestamp = frame->timestamp;
+				}
+				else {
+					std::this_thread::sleep_until(anchor_time + std::chrono::duration_cast<std::chrono::nanoseconds>((frame->timestamp - anchor_timestamp) / speed));
+
+					net::packet::Packet p{ frame->packet };
+					if (const auto it{ id_map.find(p.id) }; it != id_map.end())
+						p.id = it->second;
+					if (!net::send_packet(sd, p))
+						throw socket_exception("mode::replay()", "Failed to send a recorded frame!", LAST_SOCKET_ERROR_CODE(), net::getLastSocketErrorMessage());
+				}
+				++count;
+			}
+		} catch (const socket_except& ex) {
+			if (!Global.quiet)
+				std::cerr << Global.palette.get_warn() << "Client disconnected after " << count << " frames: " << ex.what() << '\n';
+		}
+
+		net::close_socket(sd);
+
+		if (!Global.quiet)
+			std::cout << Global.palette.get_msg() << "Replayed " << count << " frames (" << mismatched << " mismatched, " << skipped << " from other sessions skipped)." << std::endl;
+	}
+}
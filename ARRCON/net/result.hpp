@@ -0,0 +1,156 @@
+/**
+ * @file	result.hpp
+ * @author	radj307
+ * @brief	Contains the objects shared by the HostPool & Shard command executors: command results, priority lanes, and
+ *\n		the metrics that they update.
+ */
+#pragma once
+#include "../globals.h"
+#include "../json.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace net {
+	/**
+	 * @struct	CommandResult
+	 * @brief	The result of a command executed by a HostPool.
+	 */
+	struct CommandResult {
+		/// @brief	true when the complete response was received.
+		bool ok{ false };
+		/// @brief	The concatenated bodies of every response packet.
+		std::string response;
+		/// @brief	A description of the error when the command couldn't be executed.
+		std::string error;
+		/// @brief	Time from when the command was submitted until its response was received.
+		std::chrono::nanoseconds latency{ 0 };
+	};
+
+	/**
+	 * @brief			Convert a command result to a JSON object.
+	 *\n				The response is converted to UTF-8 & color codes are removed.
+	 * @param host		The host's name.
+	 * @param command	The command that was executed.
+	 * @param result	The command's result.
+	 * @returns			json::Object
+	 */
+	inline json::Object to_json(const std::string& host, const std::string& command, const CommandResult& result)
+	{
+		thread_local std::string converted, stripped;
+		json::Object obj;
+		obj.add("host", host)
+			.add("command", command)
+			.add("ok", result.ok)
+			.add("response", filter::strip_colors(encoding::to_utf8(result.response, Global.encoding, converted), stripped))
+			.add("latency_ms", std::chrono::duration<double, std::milli>(result.latency).count());
+		if (!result.error.empty())
+			obj.add("error", result.error);
+		return obj;
+	}
+
+	/**
+	 * @enum	Priority
+	 * @brief	Priority lanes of a HostPool. Queued commands in a higher lane are always sent before those in a lower lane.
+	 */
+	enum class Priority : uint8_t {
+		/// @brief	Interactive operator commands, such as "kick".
+		HIGH,
+		/// @brief	The default lane.
+		NORMAL,
+		/// @brief	Background batch jobs.
+		LOW,
+	};
+	/// @brief	The number of priority lanes.
+	inline constexpr const size_t PRIORITY_COUNT{ 3ull };
+
+	/// @brief	Get the name of a priority lane.
+	inline constexpr const char* to_string(const Priority priority)
+	{
+		switch (priority) {
+		case Priority::HIGH:
+			return "high";
+		case Priority::LOW:
+			return "low";
+		default:
+			return "normal";
+		}
+	}
+	/**
+	 * @brief		Parse the name of a priority lane.
+	 * @param str	"high", "normal", or "low".
+	 * @returns		std::optional<Priority>
+	 */
+	inline std::optional<Priority> parse_priority(const std::string_view& str)
+	{
+		if (str == "high")
+			return Priority::HIGH;
+		else if (str == "normal")
+			return Priority::NORMAL;
+		else if (str == "low")
+			return Priority::LOW;
+		return std::nullopt;
+	}
+
+	/**
+	 * @brief			Check if a command may be coalesced with an identical in-flight command.
+	 * @param command	The command.
+	 * @returns			bool	true when the command's first word is in Global.coalesce_commands.
+	 */
+	inline bool is_coalescable(const std::string_view& command)
+	{
+		const auto name{ command.substr(0ull, command.find_first_of(" \t")) };
+		return !name.empty() && std::any_of(Global.coalesce_commands.begin(), Global.coalesce_commands.end(), [&name](auto&& cmd) { return cmd == name; });
+	}
+
+	/**
+	 * @struct	LaneMetrics
+	 * @brief	Metrics of a single priority lane.
+	 */
+	struct LaneMetrics {
+		/// @brief	Number of commands waiting in the lane.
+		std::atomic<size_t> queued{ 0ull };
+		std::atomic<size_t> completed{ 0ull };
+		std::atomic<uint64_t> total_wait{ 0ull }, total_latency{ 0ull }, max_latency{ 0ull };
+
+		void record(const std::chrono::nanoseconds& wait, const std::chrono::nanoseconds& latency)
+		{
+			++completed;
+			total_wait += static_cast<uint64_t>(wait.count());
+			total_latency += static_cast<uint64_t>(latency.count());
+			for (auto max{ max_latency.load() }; static_cast<uint64_t>(latency.count()) > max && !max_latency.compare_exchange_weak(max, static_cast<uint64_t>(latency.count())); ) {}
+		}
+	};
+
+	/**
+	 * @struct	PoolMetrics
+	 * @brief	Metrics of a pool of sessions to a single host. Only atomics are used, so that they can be updated by the
+	 *\n		thread that executed a command without locking, & read from any thread.
+	 */
+	struct PoolMetrics {
+		std::atomic<size_t> connected{ 0ull }, completed{ 0ull }, errors{ 0ull };
+		/// @brief	Number of commands that were answered by an identical in-flight command instead of being sent.
+		std::atomic<size_t> coalesced{ 0ull };
+		std::array<LaneMetrics, PRIORITY_COUNT> lanes;
+
+		/**
+		 * @brief			Record a completed command.
+		 * @param priority	The lane that the command was queued in.
+		 * @param wait		Time that the command waited in the queue before being sent.
+		 * @param result	The command's result.
+		 */
+		void record(const Priority priority, const std::chrono::nanoseconds& wait, const CommandResult& result)
+		{
+			++completed;
+			if (!result.ok)
+				++errors;
+			lanes[static_cast<size_t>(priority)].record(wait, result.latency);
+		}
+	};
+}
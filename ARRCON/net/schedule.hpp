@@ -0,0 +1,404 @@
+/**
+ * @file	schedule.hpp
+ * @author	radj307
+ * @brief	Contains the scheduler mode, which runs the jobs in a jobs file at the times given by their cron expressions
+ *\n		over persistent pooled sessions, instead of starting a new process & reconnecting for every job.
+ *\n
+ *\n		Jobs file format:
+ *\n		  [group <name>]				A named list of hosts that jobs can refer to.
+ *\n		  hosts = <host>, <host>...
+ *\n
+ *\n		  [<job name>]
+ *\n		  cron = <min> <hour> <day> <month> <weekday>	Or one of @hourly, @daily, @weekly, @monthly, @yearly.
+ *\n		  hosts = <host or group>, ...					Saved host names, "default", or group names.
+ *\n		  jitter = <seconds>							Optional. Delay each run by a random amount up to this long.
+ *\n		  command = <command>							Can be specified multiple times; commands are run in order.
+ */
+#pragma once
+#include "../globals.h"
+#include "pool.hpp"
+#include "mode.hpp"
+
+#include <filei.hpp>
+#include <str.hpp>
+
+#include <bitset>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mode {
+	/**
+	 * @class	CronExpr
+	 * @brief	A standard 5-field cron expression. Each field accepts '*', numbers, & ranges "a-b", optionally followed
+	 *\n		by a step "/n", & comma-separated lists of those.
+	 *\n		As in cron, when both the day & weekday fields are restricted, a time matches if either one does.
+	 */
+	class CronExpr {
+		std::bitset<60> minutes;
+		std::bitset<24> hours;
+		std::bitset<32> days;
+		std::bitset<13> months;
+		std::bitset<8> weekdays;
+		bool any_day{ false }, any_weekday{ false };
+
+		/**
+		 * @brief			Parse a single field.
+		 * @param field		The field's text.
+		 * @param min		The minimum value.
+		 * @param max		The maximum value.
+		 * @param bits		Receives the values that the field matches.
+		 * @throws except	The field is invalid.
+		 * @returns			bool	true when the field is "*".
+		 */
+		template<size_t N>
+		static bool parse_field(const std::string& field, const int min, const int max, std::bitset<N>& bits)
+		{
+			const auto to_int{ [&field](const std::string& s) {
+				if (s.empty() || !std::all_of(s.begin(), s.end(), isdigit))
+					throw make_exception("Invalid cron field \"", field, "\"!");
+				return std::stoi(s);
+			} };
+
+			std::stringstream ss{ field };
+			for (std::string part; std::getline(ss, part, ','); ) {
+				int step{ 1 };
+				if (const auto slash{ part.find('/') }; slash != std::string::npos) {
+					step = to_int(part.substr(slash + 1ull));
+					part.erase(slash);
+				}
+				int first{ min }, last{ max };
+				if (part != "*") {
+					if (const auto dash{ part.find('-') }; dash != std::string::npos) {
+						first = to_int(part.substr(0ull, dash));
+						last = to_int(part.substr(dash + 1ull));
+					}
+					else first = last = to_int(part);
+				}
+				if (step < 1 || first < min || last > max || first > last)
+					throw make_exception("Invalid cron field \"", field, "\", values must be between ", min, " and ", max, '!');
+				for (int i{ first }; i <= last; i += step)
+					bits.set(static_cast<size_t>(i));
+			}
+			return field == "*";
+		}
+
+	public:
+		/**
+		 * @brief			Parse a cron expression.
+		 * @param expr		The expression.
+		 * @throws except	The expression is invalid.
+		 */
+		CronExpr(std::string expr)
+		{
+			if (expr == "@hourly")
+				expr = "0 * * * *";
+			else if (expr == "@daily" || expr == "@midnight")
+				expr = "0 0 * * *";
+			else if (expr == "@weekly")
+				expr = "0 0 * * 0";
+			else if (expr == "@monthly")
+				expr = "0 0 1 * *";
+			else if (expr == "@yearly" || expr == "@annually")
+				expr = "0 0 1 1 *";
+
+			std::stringstream ss{ expr };
+			std::string minute, hour, day, month, weekday, extra;
+			if (!(ss >> minute >> hour >> day >> month >> weekday) || (ss >> extra))
+				throw make_exception("Invalid cron expression \"", expr, "\", expected 5 fields!");
+			parse_field(minute, 0, 59, minutes);
+			parse_field(hour, 0, 23, hours);
+			any_day = parse_field(day, 1, 31, days);
+			parse_field(month, 1, 12, months);
+			any_weekday = parse_field(weekday, 0, 7, weekdays);
+			if (weekdays.test(7ull)) // 7 is also Sunday
+				weekdays.set(0ull);
+		}
+
+		/// @brief	Check if the expression matches a time, ignoring seconds.
+		bool matches(const std::tm& tm) const
+		{
+			if (!minutes.test(static_cast<size_t>(tm.tm_min)) || !hours.test(static_cast<size_t>(tm.tm_hour)) || !months.test(static_cast<size_t>(tm.tm_mon + 1)))
+				return false;
+			const bool day_match{ days.test(static_cast<size_t>(tm.tm_mday)) }, weekday_match{ weekdays.test(static_cast<size_t>(tm.tm_wday)) };
+			if (any_day || any_weekday)
+				return day_match && weekday_match;
+			return day_match || weekday_match;
+		}
+	};
+
+	/**
+	 * @struct	ScheduledJob
+	 * @brief	A job read from a jobs file.
+	 */
+	struct ScheduledJob {
+		std::string name;
+		CronExpr cron;
+		/// @brief	Names of the hosts to run the commands on, with groups expanded.
+		std::vector<std::string> hosts;
+		std::vector<std::string> commands;
+		std::chrono::seconds jitter{ 0 };
+	};
+
+	/**
+	 * @brief			Read a jobs file.
+	 *\n				Blank lines & comments beginning with a semicolon or pound sign are ignored.
+	 * @param path		Location of the jobs file.
+	 * @throws except	The file couldn't be read, or contains an invalid line or job.
+	 * @returns			std::vector<ScheduledJob>
+	 */
+	inline std::vector<ScheduledJob> read_jobs_file(const std::filesystem::path& path)
+	{
+		auto fss{ file::read(path) };
+		if (fss.fail())
+			throw make_exception("Failed to read jobs file ", path, '!');
+
+		struct Section {
+			std::string name, cron, jitter;
+			std::vector<std::string> hosts, commands;
+			bool is_group{ false };
+		};
+		std::vector<Section> sections;
+
+		size_t line_number{ 0ull };
+		for (std::string ln{}; std::getline(fss, ln, '\n'); ) {
+			++line_number;
+			if (ln = str::strip_line(ln, "#;"); ln.empty())
+				continue;
+			if (ln.front() == '[' && ln.back() == ']') {
+				auto& section{ sections.emplace_back() };
+				section.name = str::strip_line(ln.substr(1ull, ln.size() - 2ull));
+				if (section.name.starts_with("group ")) {
+					section.is_group = true;
+					section.name = str::strip_line(section.name.substr(6ull));
+				}
+				continue;
+			}
+			const auto eq{ ln.find('=') };
+			if (eq == std::string::npos || sections.empty())
+				throw make_exception("Invalid line ", line_number, " in jobs file ", path, ": \"", ln, "\", expected \"<key> = <value>\" inside a [section].");
+			const auto key{ str::strip_line(ln.substr(0ull, eq)) }, value{ str::strip_line(ln.substr(eq + 1ull)) };
+			auto& section{ sections.back() };
+			if (key == "hosts") {
+				std::stringstream ss{ value };
+				for (std::string host; std::getline(ss, host, ','); )
+					if (host = str::strip_line(host); !host.empty())
+						section.hosts.emplace_back(host);
+			}
+			else if (key == "command" && !section.is_group)
+				section.commands.emplace_back(value);
+			else if (key == "cron" && !section.is_group)
+				section.cron = value;
+			else if (key == "jitter" && !section.is_group)
+				section.jitter = value;
+			else throw make_exception("Unknown key \"", key, "\" on line ", line_number, " in jobs file ", path, '!');
+		}
+
+		std::map<std::string, std::vector<std::string>> groups;
+		for (const auto& section : sections)
+			if (section.is_group)
+				groups[section.name] = section.hosts;
+
+		std::vector<ScheduledJob> jobs;
+		for (const auto& section : sections) {
+			if (section.is_group)
+				continue;
+			if (section.cron.empty() || section.hosts.empty() || section.commands.empty())
+				throw make_exception("Job \"", section.name, "\" in jobs file ", path, " must have a cron expression, at least one host, and at least one command!");
+			if (!section.jitter.empty() && !std::all_of(section.jitter.begin(), section.jitter.end(), isdigit))
+				throw make_exception("Invalid jitter \"", section.jitter, "\" for job \"", section.name, "\", expected a number of seconds.");
+
+			ScheduledJob job{ section.name, CronExpr{ section.cron }, {}, section.commands, std::chrono::seconds{ section.jitter.empty() ? 0ll : std::stoll(section.jitter) } };
+			for (const auto& host : section.hosts) {
+				if (const auto it{ groups.find(host) }; it != groups.end())
+					job.hosts.insert(job.hosts.end(), it->second.begin(), it->second.end());
+				else job.hosts.emplace_back(host);
+			}
+			jobs.emplace_back(std::move(job));
+		}
+		return jobs;
+	}
+
+	/**
+	 * @class	Scheduler
+	 * @brief	Runs scheduled jobs on a background thread each, & skips runs of jobs that are still running.
+	 */
+	class Scheduler {
+		/// @brief	The state of a single job.
+		struct Run {
+			ScheduledJob job;
+			std::atomic<bool> running{ false };
+			std::thread thread;
+
+			Run(ScheduledJob&& job) : job{ std::move(job) } {}
+		};
+
+		net::PoolRegistry& pools;
+		std::vector<std::unique_ptr<Run>> runs;
+		std::mutex out_mtx;
+
+		/// @brief	Sleep for the specified duration, or until the scheduler is interrupted.
+		static void sleep_for(std::chrono::milliseconds duration)
+		{
+			using namespace std::chrono_literals;
+			for (; duration > 0ms && Global.connected; duration -= 100ms)
+				std::this_thread::sleep_for(std::min(duration, std::chrono::milliseconds{ 100ms }));
+		}
+
+		/// @brief	Print a command's result, with every line tagged by the job & host names.
+		void print(const ScheduledJob& job, const std::string& host, const net::CommandResult& result)
+		{
+			if (!result.error.empty()) {
+				std::scoped_lock lock(out_mtx);
+				std::cerr << Global.palette.get_error() << '[' << job.name << "] [" << host << "] " << result.error << std::endl;
+				return;
+			}
+			if (Global.quiet)
+				return;
+			std::string converted, stripped;
+			const auto tag{ str::stringify(Global.palette.set(Color::YELLOW), '[', job.name, "] [", host, ']', Global.palette.reset(), ' ') };
+			std::string out;
+			filter::for_each_line(filter::strip_colors(encoding::to_utf8(result.response, Global.encoding, converted), stripped), [&](const std::string_view& line) {
+				if (Global.filter.passes(line))
+					out.append(tag).append(line).push_back('\n');
+			});
+			std::scoped_lock lock(out_mtx);
+			(std::cout << out).flush();
+		}
+
+		/// @brief	Run a job's commands in order on every host concurrently.
+		void execute(Run& run)
+		{
+			if (run.job.jitter.count() > 0) {
+				thread_local std::mt19937_64 rng{ std::random_device{}() };
+				sleep_for(std::chrono::milliseconds{ std::uniform_int_distribution<long long>{ 0ll, std::chrono::duration_cast<std::chrono::milliseconds>(run.job.jitter).count() }(rng) });
+			}
+
+			for (const auto& command : run.job.commands) {
+				if (!Global.connected)
+					break;
+				std::vector<std::future<net::CommandResult>> futures;
+				futures.reserve(run.job.hosts.size());
+				for (const auto& host : run.job.hosts) {
+					if (auto* pool{ pools.get(host) })
+						futures.emplace_back(pool->submit(command, net::Priority::LOW));
+					else { // the host was removed from the hosts file after the scheduler started
+						std::promise<net::CommandResult> removed;
+						removed.set_value(net::CommandResult{ false, {}, "The host no longer exists.", {} });
+						futures.emplace_back(removed.get_future());
+					}
+				}
+				for (size_t i{ 0ull }; i < futures.size(); ++i)
+					print(run.job, run.job.hosts[i], futures[i].get());
+				sleep_for(Global.command_delay.load());
+			}
+			run.running = false;
+		}
+
+	public:
+		/**
+		 * @brief			Constructor.
+		 * @param pools		The host pools that jobs are run with.
+		 * @param jobs		The jobs to run.
+		 * @throws except	A job refers to a host that doesn't exist.
+		 */
+		Scheduler(net::PoolRegistry& pools, std::vector<ScheduledJob> jobs) : pools{ pools }
+		{
+			for (auto& job : jobs) {
+				for (const auto& host : job.hosts)
+					if (!pools.contains(host))
+						throw make_exception("Job \"", job.name, "\" refers to unknown host or group \"", host, "\"!");
+				runs.emplace_back(std::make_unique<Run>(std::move(job)));
+			}
+		}
+		Scheduler(const Scheduler&) = delete;
+		Scheduler& operator=(const Scheduler&) = delete;
+		/// @brief	Wait for running jobs to finish.
+		~Scheduler()
+		{
+			for (auto& run : runs)
+				if (run->thread.joinable())
+					run->thread.join();
+		}
+
+		/// @brief	Open a session to every host that a job refers to, so that the first runs don't have to wait for them.
+		void connect()
+		{
+			std::map<std::string, std::future<net::CommandResult>> futures;
+			for (const auto& run : runs)
+				for (const auto& host : run->job.hosts)
+					if (!futures.contains(host))
+						futures.emplace(host, pools.get(host)->submit({}));
+			for (auto& [host, future] : futures)
+				if (const auto result{ future.get() }; !result.ok)
+					std::cerr << Global.palette.get_warn() << "Failed to connect to \"" << host << "\", retrying when its jobs run: " << result.error << std::endl;
+		}
+
+		/**
+		 * @brief		Start every job that matches a time. Jobs whose previous run hasn't finished yet are skipped.
+		 * @param tm	The time to check, in local time.
+		 */
+		void tick(const std::tm& tm)
+		{
+			for (auto& run : runs) {
+				if (!run->job.cron.matches(tm))
+					continue;
+				if (run->running) {
+					std::scoped_lock lock(out_mtx);
+					std::cerr << Global.palette.get_warn() << "Skipped job \"" << run->job.name << "\" because its previous run hasn't finished." << std::endl;
+					continue;
+				}
+				if (run->thread.joinable())
+					run->thread.join();
+				run->running = true;
+				run->thread = std::thread{ &Scheduler::execute, this, std::ref(*run) };
+			}
+		}
+	};
+
+	/**
+	 * @brief			Run the jobs in a jobs file at their scheduled times until interrupted.
+	 * @param pools		The host pools that jobs are run with.
+	 * @param jobs		The jobs to run.
+	 */
+	inline void schedule(net::PoolRegistry& pools, std::vector<ScheduledJob> jobs)
+	{
+		Scheduler scheduler{ pools, std::move(jobs) };
+
+	#ifdef OS_WIN
+		if (!SetConsoleCtrlHandler(sighandler, TRUE))
+			throw make_exception("Failed to install Windows Control+C handler!");
+	#else
+		struct sigaction action {};
+		action.sa_handler = sighandler;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = 0;
+		sigaction(SIGINT, &action, nullptr);
+	#endif
+		Global.connected = true;
+
+		scheduler.connect();
+		if (!Global.quiet)
+			std::cout << Global.palette.get_msg() << "Scheduler started; use <Ctrl + C> to stop." << std::endl;
+
+		using clock = std::chrono::system_clock;
+		auto next{ std::chrono::floor<std::chrono::minutes>(clock::now()) + std::chrono::minutes{ 1 } };
+		while (Global.connected) {
+			if (const auto now{ clock::now() }; now < next) {
+				std::this_thread::sleep_for(std::min(std::chrono::duration_cast<std::chrono::milliseconds>(next - now) + std::chrono::milliseconds{ 1 }, std::chrono::milliseconds{ 250 }));
+				continue;
+			}
+			const auto time{ clock::to_time_t(next) };
+			scheduler.tick(*std::localtime(&time));
+			next = std::chrono::floor<std::chrono::minutes>(clock::now()) + std::chrono::minutes{ 1 };
+		}
+	}
+}
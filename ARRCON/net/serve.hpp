@@ -0,0 +1,256 @@
+/**
+ * @file	serve.hpp
+ * @author	radj307
+ * @brief	Contains the stdio server mode, which reads newline-delimited JSON-RPC 2.0 requests from STDIN & writes the
+ *\n		responses to STDOUT, so that other programs can drive many commands through a single child process.
+ *\n
+ *\n		Methods:
+ *\n		  connect	{"host":"<saved name>"} and/or {"hostname","port","password"}	->	{"session":<id>,"host":"<name>"}
+ *\n		  command	{"session":<id>,"command":"<command>"[,"priority":"high|normal|low"]}	->	{"host","command","ok","response","latency_ms"}
+ *\n		  close		{"session":<id>}												->	true
+ *\n
+ *\n		Connections & commands are executed concurrently, so responses may be written in a different order than the
+ *\n		requests were read; use the "id" member to correlate them. A session can be used once "connect" has responded.
+ */
+#pragma once
+#include "../globals.h"
+#include "../json.hpp"
+#include "pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace mode {
+	/**
+	 * @class	StdioServer
+	 * @brief	Handles JSON-RPC requests, holding a session open for each successful "connect" until it is closed.
+	 */
+	class StdioServer {
+		/// @brief	JSON-RPC error codes.
+		enum ErrorCode : int {
+			PARSE_ERROR = -32700,
+			INVALID_REQUEST = -32600,
+			METHOD_NOT_FOUND = -32601,
+			INVALID_PARAMS = -32602,
+			CONNECTION_ERROR = -32000,
+		};
+
+		mutable std::mutex targets_mtx;
+		std::map<std::string, net::HostInfo> targets;
+		std::mutex sessions_mtx;
+		std::map<uint64_t, std::pair<std::string, std::unique_ptr<net::HostPool>>> sessions;
+		uint64_t next_session{ 1ull };
+
+		std::mutex out_mtx;
+		std::atomic<size_t> pending{ 0ull };
+
+		/// @brief	Write a line to STDOUT.
+		void write(const std::string& line)
+		{
+			std::scoped_lock lock(out_mtx);
+			(std::cout << line << '\n').flush();
+		}
+
+		/// @brief	Write a successful response. Nothing is written for notifications, which have no id.
+		void respond(const json::Value* id, const std::string_view& result)
+		{
+			if (id == nullptr)
+				return;
+			std::string line{ "{\"jsonrpc\":\"2.0\",\"id\":" };
+			json::append_value(line, *id);
+			line.append(",\"result\":").append(result).push_back('}');
+			write(line);
+		}
+
+		/// @brief	Write an error response. The id is null when the request's id couldn't be determined.
+		void respond_error(const json::Value* id, const int& code, const std::string_view& message)
+		{
+			std::string line{ "{\"jsonrpc\":\"2.0\",\"id\":" };
+			if (id == nullptr)
+				line += "null";
+			else json::append_value(line, *id);
+			line.append(",\"error\":").append(json::Object{}.add("code", code).add("message", message).str()).push_back('}');
+			write(line);
+		}
+
+		/// @brief	Get a string parameter, or nullptr if it is missing or isn't a string.
+		static const std::string* get_string(const json::Value* params, const std::string_view& name)
+		{
+			if (params == nullptr)
+				return nullptr;
+			const auto* value{ params->find(name) };
+			return value != nullptr && value->is_string() ? &value->string : nullptr;
+		}
+
+		/// @brief	Find the session specified by the "session" parameter. The caller must hold sessions_mtx.
+		decltype(sessions)::iterator find_session(const json::Value* params)
+		{
+			if (params == nullptr)
+				return sessions.end();
+			const auto* value{ params->find("session") };
+			if (value == nullptr || !value->is_number() || value->number < 1.0)
+				return sessions.end();
+			return sessions.find(static_cast<uint64_t>(value->number));
+		}
+
+		void connect(const json::Value* id, const json::Value* params)
+		{
+			const auto* name{ get_string(params, "host") };
+			const std::string host_name{ name == nullptr ? "default" : *name };
+			net::HostInfo target;
+			{
+				std::scoped_lock lock(targets_mtx);
+				const auto it{ targets.find(host_name) };
+				if (it == targets.end())
+					return respond_error(id, INVALID_PARAMS, "There is no host named \"" + host_name + "\".");
+				target = it->second;
+			}
+			if (const auto* hostname{ get_string(params, "hostname") })
+				target.hostname = *hostname;
+			if (const auto* port{ get_string(params, "port") })
+				target.port = *port;
+			if (const auto* password{ get_string(params, "password") })
+				target.password = *password;
+
+			// connect on another thread so that other requests can be read in the meantime; the session is registered once it's open
+			++pending;
+			std::thread([this, id = id == nullptr ? std::optional<json::Value>{} : std::optional<json::Value>{ *id }, host_name, target = std::move(target)]() mutable {
+				const auto* id_ptr{ id.has_value() ? &id.value() : nullptr };
+				auto pool{ std::make_unique<net::HostPool>(std::make_shared<const net::HostInfo>(std::move(target)), 1ull) };
+				if (const auto result{ pool->submit({}).get() }; !result.ok)
+					respond_error(id_ptr, CONNECTION_ERROR, result.error);
+				else {
+					uint64_t session;
+					{
+						std::scoped_lock lock(sessions_mtx);
+						session = next_session++;
+						sessions.emplace(session, std::make_pair(host_name, std::move(pool)));
+					}
+					respond(id_ptr, json::Object{}.add("session", session).add("host", host_name).str());
+				}
+				--pending;
+			}).detach();
+		}
+
+		void command(const json::Value* id, const json::Value* params)
+		{
+			std::scoped_lock lock(sessions_mtx);
+			const auto it{ find_session(params) };
+			if (it == sessions.end())
+				return respond_error(id, INVALID_PARAMS, "Missing or unknown \"session\".");
+			const auto* cmd{ get_string(params, "command") };
+			if (cmd == nullptr || cmd->empty())
+				return respond_error(id, INVALID_PARAMS, "Missing \"command\".");
+
+			auto priority{ net::Priority::NORMAL };
+			if (const auto* name{ get_string(params, "priority") }) {
+				if (const auto p{ net::parse_priority(*name) }; p.has_value())
+					priority = p.value();
+				else return respond_error(id, INVALID_PARAMS, "Invalid \"priority\"; expected \"high\", \"normal\", or \"low\".");
+			}
+
+			// wait for the response on another thread so that other requests can be read in the meantime
+			++pending;
+			std::thread([this, id = id == nullptr ? std::optional<json::Value>{} : std::optional<json::Value>{ *id }, host = it->second.first, command = *cmd, future = it->second.second->submit(*cmd, priority)]() mutable {
+				const auto result{ future.get() };
+				const auto* id_ptr{ id.has_value() ? &id.value() : nullptr };
+				if (result.error.empty())
+					respond(id_ptr, net::to_json(host, command, result).str());
+				else respond_error(id_ptr, CONNECTION_ERROR, result.error);
+				--pending;
+			}).detach();
+		}
+
+		void close(const json::Value* id, const json::Value* params)
+		{
+			decltype(sessions)::node_type node;
+			{
+				std::scoped_lock lock(sessions_mtx);
+				const auto it{ find_session(params) };
+				if (it == sessions.end())
+					return respond_error(id, INVALID_PARAMS, "Missing or unknown \"session\".");
+				node = sessions.extract(it);
+			}
+			node = {}; //< finishes queued commands before closing the session
+			respond(id, "true");
+		}
+
+	public:
+		/**
+		 * @brief			Constructor.
+		 * @param targets	Map of host names to their connection information. Used by "connect".
+		 */
+		StdioServer(std::map<std::string, net::HostInfo> targets) : targets{ std::move(targets) } {}
+		StdioServer(const StdioServer&) = delete;
+		StdioServer& operator=(const StdioServer&) = delete;
+		/// @brief	Wait for every response to be written, including pending connections, then close every session.
+		~StdioServer()
+		{
+			while (pending.load() != 0ull)
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+			sessions.clear();
+		}
+
+		/**
+		 * @brief			Replace the map of host names to their connection information used by "connect".
+		 *\n				Sessions that are already open aren't affected.
+		 * @param updated	The new map of host names to their connection information.
+		 */
+		void update(std::map<std::string, net::HostInfo> updated)
+		{
+			std::scoped_lock lock(targets_mtx);
+			targets = std::move(updated);
+		}
+
+		/**
+		 * @brief		Handle a single request.
+		 * @param line	A line containing a JSON-RPC request.
+		 */
+		void handle(const std::string& line)
+		{
+			json::Value request;
+			try {
+				request = json::parse(line);
+			} catch (const std::exception& ex) {
+				return respond_error(nullptr, PARSE_ERROR, ex.what());
+			}
+
+			const auto* id{ request.find("id") };
+			const auto* method{ request.find("method") };
+			if (!request.is_object() || method == nullptr || !method->is_string())
+				return respond_error(id, INVALID_REQUEST, "Expected an object with a \"method\".");
+			const auto* params{ request.find("params") };
+			if (params != nullptr && !params->is_object())
+				return respond_error(id, INVALID_PARAMS, "\"params\" must be an object.");
+
+			if (method->string == "command")
+				command(id, params);
+			else if (method->string == "connect")
+				connect(id, params);
+			else if (method->string == "close")
+				close(id, params);
+			else respond_error(id, METHOD_NOT_FOUND, "Unknown method \"" + method->string + "\"; expected \"connect\", \"command\", or \"close\".");
+		}
+	};
+
+	/**
+	 * @brief			Serve JSON-RPC requests from STDIN until it is closed.
+	 * @param server	The server.
+	 */
+	inline void serve_stdio(StdioServer& server)
+	{
+		for (std::string line; std::getline(std::cin, line); ) {
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			if (line.find_first_not_of(" \t") != std::string::npos)
+				server.handle(line);
+		}
+	}
+}
@@ -0,0 +1,122 @@
+/**
+ * @file	session.hpp
+ * @author	radj307
+ * @brief	Contains the Session object, an authenticated RCON connection that manages its own socket.
+ *\n		Used by modes that open more than one connection at a time.
+ */
+#pragma once
+#include "rcon.hpp"
+#include "objects/HostInfo.hpp"
+
+#include <chrono>
+
+namespace net {
+	/**
+	 * @class	Session
+	 * @brief	An authenticated RCON connection that is closed when destroyed.
+	 */
+	class Session {
+		SOCKET sd{ static_cast<SOCKET>(SOCKET_ERROR) };
+
+	public:
+		/// @brief	Time taken by net::connect() when the session was opened.
+		std::chrono::nanoseconds connect_time{ 0 };
+		/// @brief	Time taken by rcon::authenticate() when the session was opened.
+		std::chrono::nanoseconds auth_time{ 0 };
+
+		Session() = default;
+		/**
+		 * @brief			Connect & authenticate with the given target.
+		 * @param target	The target server's connection information.
+		 * @throws			connection_except	Connection or authentication failed.
+		 */
+		Session(const HostInfo& target) { open(target); }
+		/**
+		 * @brief		Take ownership of a socket that is already connected & authenticated, such as one received from
+		 *\n			another process during an upgrade.
+		 * @param sd	The socket descriptor.
+		 */
+		explicit Session(const SOCKET& sd) : sd{ sd } {}
+		Session(const Session&) = delete;
+		Session(Session&& o) noexcept : sd{ o.sd }, connect_time{ o.connect_time }, auth_time{ o.auth_time } { o.sd = static_cast<SOCKET>(SOCKET_ERROR); }
+		~Session() { close(); }
+
+		Session& operator=(const Session&) = delete;
+		Session& operator=(Session&& o) noexcept
+		{
+			if (this != &o) {
+				close();
+				sd = o.sd;
+				connect_time = o.connect_time;
+				auth_time = o.auth_time;
+				o.sd = static_cast<SOCKET>(SOCKET_ERROR);
+			}
+			return *this;
+		}
+
+		/**
+		 * @brief			Connect & authenticate with the given target, closing the current connection first if there is one.
+		 * @param target	The target server's connection information.
+		 * @throws			connection_except	Connection or authentication failed.
+		 */
+		void open(const HostInfo& target)
+		{
+			close();
+			rcon::require_password(target.hostname, target.port, target.password);
+			const auto t0{ std::chrono::steady_clock::now() };
+			sd = net::connect(target.hostname, target.port);
+			const auto t1{ std::chrono::steady_clock::now() };
+			if (!rcon::authenticate(sd, target.password)) {
+				close();
+				throw badpass_exception(target.hostname, target.port, LAST_SOCKET_ERROR_CODE(), net::getLastSocketErrorMessage());
+			}
+			connect_time = t1 - t0;
+			auth_time = std::chrono::steady_clock::now() - t1;
+		}
+
+		/// @brief	Close the connection, if it is open.
+		void close()
+		{
+			if (is_open()) {
+				net::close_socket(sd);
+				sd = static_cast<SOCKET>(SOCKET_ERROR);
+			}
+		}
+
+		/// @brief	Check if the session is connected.
+		bool is_open() const { return sd != static_cast<SOCKET>(SOCKET_ERROR); }
+
+		/// @brief	Get the session's socket descriptor.
+		const SOCKET& socket() const { return sd; }
+
+		/**
+		 * @brief	Give up ownership of the socket without closing it.
+		 * @returns	SOCKET
+		 */
+		SOCKET release()
+		{
+			const auto released{ sd };
+			sd = static_cast<SOCKET>(SOCKET_ERROR);
+			return released;
+		}
+
+		/**
+		 * @brief			Execute a command using rcon::exchange().
+		 *\n				When the command times out, the session is closed, since the rest of the response may still arrive.
+		 * @param command	Command string to send.
+		 * @param handler	Function that is called with each response packet.
+		 * @throws			socket_except	The session isn't open, or the connection was lost.
+		 * @returns			true when the complete response was received.
+		 */
+		template<std::invocable<const packet::Packet&> Handler>
+		bool exchange(const std::string& command, Handler&& handler)
+		{
+			if (!is_open())
+				throw socket_exception("net::Session::exchange()", "The session was closed after a command timed out.");
+			const bool ok{ rcon::exchange(sd, command, std::forward<Handler>(handler)) };
+			if (!ok)
+				close();
+			return ok;
+		}
+	};
+}
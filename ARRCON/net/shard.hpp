@@ -0,0 +1,841 @@
+/**
+ * @file	shard.hpp
+ * @author	radj307
+ * @brief	Contains the Shard object, a worker thread that owns a disjoint set of hosts & every connection to them, and
+ *\n		drives them all from a single non-blocking event loop. Used by HostPool when [--shards] is specified, so that a
+ *\n		process holding connections to thousands of hosts needs a fixed number of threads, & no locks are shared
+ *\n		between them on the path of a command.
+ *\n		Idle sessions are kept small so that thousands of them can be held open: a connection only holds its socket,
+ *\n		state, & timers, & borrows buffers from its shard while it is connecting or executing a command.
+ */
+#pragma once
+#include "result.hpp"
+#include "rcon.hpp"
+#include "objects/HostInfo.hpp"
+
+#include <make_exception.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#ifdef OS_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace net {
+	/**
+	 * @class	MpscQueue
+	 * @brief	An intrusive, unbounded, lock-free queue with any number of producers & a single consumer.
+	 *\n		Pushing is a single atomic exchange, so producers never wait for each other or for the consumer.
+	 * @tparam T	The node type. Must be default-constructible & have a std::atomic<T*> member named next.
+	 */
+	template<typename T>
+	class MpscQueue {
+		T stub;
+		std::atomic<T*> head{ &stub };
+		/// @brief	Only accessed by the consumer.
+		T* tail{ &stub };
+
+	public:
+		MpscQueue() = default;
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		/// @brief	Push a node onto the queue. May be called from any thread.
+		void push(T* node)
+		{
+			node->next.store(nullptr, std::memory_order_relaxed);
+			T* prev{ head.exchange(node, std::memory_order_acq_rel) };
+			prev->next.store(node, std::memory_order_release);
+		}
+
+		/**
+		 * @brief	Pop a node from the queue. May only be called from the consumer thread.
+		 * @returns	T*	The oldest node, or nullptr when the queue is empty or a producer is part-way through a push.
+		 */
+		T* pop()
+		{
+			T* node{ tail };
+			T* next{ node->next.load(std::memory_order_acquire) };
+			if (node == &stub) {
+				if (next == nullptr)
+					return nullptr;
+				tail = node = next;
+				next = next->next.load(std::memory_order_acquire);
+			}
+			if (next != nullptr) {
+				tail = next;
+				return node;
+			}
+			if (node != head.load(std::memory_order_acquire))
+				return nullptr;
+			push(&stub);
+			if (next = node->next.load(std::memory_order_acquire); next != nullptr) {
+				tail = next;
+				return node;
+			}
+			return nullptr;
+		}
+	};
+
+#ifdef OS_LINUX
+	/**
+	 * @class	Shard
+	 * @brief	A worker thread that executes commands on the hosts assigned to it using non-blocking sockets & epoll.
+	 *\n		Other threads communicate with it only through a lock-free queue; everything else, including the queued
+	 *\n		commands, connections, receive buffers, & timers, belongs to the shard's thread.
+	 *\n		Each host behaves like a HostPool: it has up to a fixed number of sessions, priority lanes, & coalescing.
+	 */
+	class Shard {
+		/// @brief	Maximum time to wait for a connection, an authentication response, or a command's response.
+		static constexpr const std::chrono::seconds TIMEOUT{ 10 };
+		/// @brief	Maximum time between checks of the connections' timers.
+		static constexpr const std::chrono::milliseconds TIMER_INTERVAL{ 100 };
+		/// @brief	Size of the buffer that sockets are read into.
+		static constexpr const size_t RECV_BUFFER_SIZE{ 65536ull };
+		/// @brief	Maximum number of spare connection buffers kept for reuse.
+		static constexpr const size_t MAX_SPARE_BUFFERS{ 64ull };
+		/// @brief	Connection buffers that grew beyond this capacity are freed instead of being kept for reuse.
+		static constexpr const size_t MAX_SPARE_CAPACITY{ 16384ull };
+
+		/**
+		 * @struct	Message
+		 * @brief	A request from another thread. Commands stay in their message until they complete; REMOVE messages
+		 *\n		use the result to signal that the host was removed.
+		 */
+		struct Message {
+			enum class Kind : uint8_t {
+				ADD,
+				SUBMIT,
+				RETARGET,
+				REMOVE,
+			};
+
+			std::atomic<Message*> next{ nullptr };
+			Kind kind{ Kind::SUBMIT };
+			Priority priority{ Priority::NORMAL };
+			/// @brief	When true, other callers may be waiting for this command's result in Host::inflight.
+			bool coalesced{ false };
+			size_t slot{ 0ull };
+			std::string command;
+			std::chrono::steady_clock::time_point submitted;
+			std::promise<CommandResult> result;
+
+			// ADD & RETARGET:
+			std::shared_ptr<const HostInfo> target;
+			size_t size{ 0ull };
+			PoolMetrics* metrics{ nullptr };
+		};
+
+		enum class State : uint8_t {
+			CONNECTING,
+			AUTHENTICATING,
+			IDLE,
+			BUSY,
+			CLOSED,
+		};
+
+		/**
+		 * @struct	Buffers
+		 * @brief	The buffers of a connection that is authenticating or executing a command.
+		 */
+		struct Buffers {
+			/// @brief	Bytes that haven't been sent yet.
+			std::string out;
+			/// @brief	Bytes of an incomplete packet.
+			std::string in;
+			std::string response;
+		};
+
+		/**
+		 * @struct	Connection
+		 * @brief	A single non-blocking session.
+		 */
+		struct Connection {
+			int fd{ -1 };
+			State state{ State::CONNECTING };
+			bool writing{ false };
+			/// @brief	The ID of the authentication or command packet, & of the terminator packet.
+			int request_id{ 0 }, terminator_id{ 0 };
+			size_t slot{ 0ull }, generation{ 0ull };
+			/// @brief	The command being executed, while BUSY.
+			Message* job{ nullptr };
+			/// @brief	Borrowed from the shard while needed; idle connections don't have any.
+			std::unique_ptr<Buffers> buffers;
+			std::chrono::nanoseconds wait{ 0 };
+			std::chrono::steady_clock::time_point deadline;
+		};
+		// idle sessions must stay small; see the file's description
+		static_assert(sizeof(Connection) <= 64ull, "An idle session should cost at most a cache line.");
+
+		/**
+		 * @struct	Lane
+		 * @brief	A FIFO of commands linked through Message::next, which is free once a message has left the queue.
+		 *\n		Unlike std::deque, an empty lane doesn't allocate.
+		 */
+		struct Lane {
+			Message* head{ nullptr };
+			Message* tail{ nullptr };
+
+			bool empty() const { return head == nullptr; }
+			Message* front() const { return head; }
+			void push_back(Message* msg)
+			{
+				msg->next.store(nullptr, std::memory_order_relaxed);
+				if (tail == nullptr)
+					head = msg;
+				else tail->next.store(msg, std::memory_order_relaxed);
+				tail = msg;
+			}
+			void pop_front()
+			{
+				if (head = head->next.load(std::memory_order_relaxed); head == nullptr)
+					tail = nullptr;
+			}
+		};
+
+		/**
+		 * @struct	Host
+		 * @brief	The state of a host assigned to the shard.
+		 */
+		struct Host {
+			size_t slot;
+			/// @brief	Shared with the HostPool, so that each host's connection information is only stored once.
+			std::shared_ptr<const HostInfo> target;
+			size_t generation{ 1ull }, size;
+			PoolMetrics* metrics;
+			std::array<Lane, PRIORITY_COUNT> lanes;
+			size_t queued{ 0ull };
+			std::map<std::pair<Priority, std::string>, std::vector<Message*>> inflight;
+			std::vector<std::unique_ptr<Connection>> connections;
+			/// @brief	Set when the host should be removed once its queued commands have completed.
+			Message* removing{ nullptr };
+
+			Host(const size_t slot, std::shared_ptr<const HostInfo> target, const size_t size, PoolMetrics* metrics) : slot{ slot }, target{ std::move(target) }, size{ size }, metrics{ metrics } {}
+
+			/// @brief	Get the oldest command in the highest non-empty lane, or nullptr.
+			Message* front() const
+			{
+				for (const auto& lane : lanes)
+					if (!lane.empty())
+						return lane.front();
+				return nullptr;
+			}
+		};
+
+		// shared with other threads:
+		MpscQueue<Message> queue;
+		std::atomic<bool> signaled{ false }, stop{ false };
+		std::atomic<size_t> next_slot{ 1ull };
+		int epfd, evfd;
+		std::thread thread;
+
+		// owned by the shard's thread:
+		std::unordered_map<size_t, Host> hosts;
+		/// @brief	Connections that were closed while handling events; freed once the events have been handled.
+		std::vector<std::unique_ptr<Connection>> closed;
+		/// @brief	Slots of hosts being removed whose commands completed while handling events.
+		std::vector<size_t> removable;
+		int next_id{ packet::PID_MIN };
+		/// @brief	Every connection is read into this buffer, & packets are parsed from it without being copied.
+		std::unique_ptr<char[]> buffer{ std::make_unique<char[]>(RECV_BUFFER_SIZE) };
+		std::vector<std::unique_ptr<Buffers>> spare;
+
+		/// @brief	Get the next packet ID. Each shard has its own counter, so shards never contend on it.
+		int get_id()
+		{
+			if (next_id >= packet::PID_MAX)
+				next_id = packet::PID_MIN;
+			return next_id++;
+		}
+
+		/// @brief	Append a serialized packet to a connection's output.
+		static void append_packet(std::string& out, const int id, const int type, const std::string_view& body)
+		{
+			const int fields[]{ static_cast<int>(sizeof(int) * 2ull + body.size() + 2ull), id, type };
+			out.append(reinterpret_cast<const char*>(fields), sizeof(fields)).append(body).append(2ull, '\0');
+		}
+
+		/// @brief	Get a connection's buffers, borrowing them from the spare buffers if it doesn't have any.
+		Buffers& borrow(Connection& conn)
+		{
+			if (conn.buffers == nullptr) {
+				if (spare.empty())
+					conn.buffers = std::make_unique<Buffers>();
+				else {
+					conn.buffers = std::move(spare.back());
+					spare.pop_back();
+				}
+			}
+			return *conn.buffers;
+		}
+
+		/// @brief	Return a connection's buffers to the spare buffers. They're freed instead when they've grown too large.
+		void give_back(Connection& conn)
+		{
+			if (conn.buffers == nullptr)
+				return;
+			auto buffers{ std::move(conn.buffers) };
+			if (spare.size() >= MAX_SPARE_BUFFERS || buffers->out.capacity() > MAX_SPARE_CAPACITY || buffers->in.capacity() > MAX_SPARE_CAPACITY || buffers->response.capacity() > MAX_SPARE_CAPACITY)
+				return;
+			buffers->out.clear();
+			buffers->in.clear();
+			buffers->response.clear();
+			spare.emplace_back(std::move(buffers));
+		}
+
+		/// @brief	Wake the shard's thread up if it is waiting. A single write is shared by every message pushed before it wakes.
+		void wake()
+		{
+			if (!signaled.exchange(true)) {
+				const uint64_t one{ 1ull };
+				[[maybe_unused]] const auto rc{ ::write(evfd, &one, sizeof(one)) };
+			}
+		}
+
+		/// @brief	Create a message.
+		static Message* make_message(const Message::Kind kind, const size_t slot)
+		{
+			auto* msg{ new Message };
+			msg->kind = kind;
+			msg->slot = slot;
+			return msg;
+		}
+
+		/// @brief	Push a message to the shard & wake it up.
+		void post(Message* msg)
+		{
+			queue.push(msg);
+			wake();
+		}
+
+		/// @brief	Update the events that the event loop waits for on a connection.
+		void watch(Connection& conn, const bool writing)
+		{
+			if (conn.writing == writing)
+				return;
+			conn.writing = writing;
+			epoll_event ev{ static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP | (writing ? static_cast<int>(EPOLLOUT) : 0)), { .ptr = &conn } };
+			::epoll_ctl(epfd, EPOLL_CTL_MOD, conn.fd, &ev);
+		}
+
+		/// @brief	Complete a command, giving its result to every caller waiting for it.
+		void complete(Host& host, Message* job, CommandResult result, const std::chrono::nanoseconds& wait)
+		{
+			const auto now{ std::chrono::steady_clock::now() };
+			result.latency = now - job->submitted;
+			host.metrics->record(job->priority, wait, result);
+			if (job->coalesced) {
+				const auto it{ host.inflight.find(std::make_pair(job->priority, job->command)) };
+				for (auto* waiter : it->second) {
+					auto copy{ result };
+					copy.latency = now - waiter->submitted;
+					waiter->result.set_value(std::move(copy));
+					delete waiter;
+				}
+				host.inflight.erase(it);
+			}
+			job->result.set_value(std::move(result));
+			delete job;
+			if (host.removing != nullptr)
+				removable.emplace_back(host.slot);
+		}
+
+		/// @brief	Fail every queued command of a host.
+		void fail_queued(Host& host, const std::string& error)
+		{
+			for (size_t i{ 0ull }; i < PRIORITY_COUNT; ++i) {
+				auto& lane{ host.lanes[i] };
+				while (!lane.empty()) {
+					auto* job{ lane.front() };
+					lane.pop_front();
+					--host.queued;
+					--host.metrics->lanes[i].queued;
+					complete(host, job, CommandResult{ false, {}, error, {} }, std::chrono::steady_clock::now() - job->submitted);
+				}
+			}
+		}
+
+		/**
+		 * @brief			Close a connection. Its command, if it has one, fails with the given error.
+		 *\n				If it failed before it was authenticated, every queued command of the host fails too.
+		 * @param host		The connection's host.
+		 * @param conn		The connection.
+		 * @param error		The reason that the connection was closed, or an empty string if it was closed normally.
+		 */
+		void close(Host& host, Connection& conn, const std::string& error = {})
+		{
+			if (conn.state == State::CLOSED)
+				return;
+			const auto state{ conn.state };
+			conn.state = State::CLOSED;
+			::epoll_ctl(epfd, EPOLL_CTL_DEL, conn.fd, nullptr);
+			close_socket(static_cast<SOCKET>(conn.fd));
+			if (state == State::IDLE || state == State::BUSY)
+				--host.metrics->connected;
+
+			const auto it{ std::find_if(host.connections.begin(), host.connections.end(), [&conn](auto&& c) { return c.get() == &conn; }) };
+			closed.emplace_back(std::move(*it));
+			host.connections.erase(it);
+
+			if (conn.job != nullptr) {
+				auto* job{ conn.job };
+				conn.job = nullptr;
+				complete(host, job, CommandResult{ false, std::move(conn.buffers->response), error, {} }, conn.wait);
+			}
+			give_back(conn);
+			if ((state == State::CONNECTING || state == State::AUTHENTICATING) && !error.empty())
+				fail_queued(host, error);
+		}
+
+		/// @brief	Send as much of a connection's output as the socket accepts.
+		void flush(Host& host, Connection& conn)
+		{
+			for (auto& out{ borrow(conn).out }; !out.empty(); ) {
+				const auto sent{ ::send(conn.fd, out.data(), out.size(), MSG_NOSIGNAL) };
+				if (sent > 0)
+					out.erase(0ull, static_cast<size_t>(sent));
+				else if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+					return watch(conn, true);
+				else return close(host, conn, socket_exception("net::Shard", "Failed to send the command!", LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage()).what());
+			}
+			watch(conn, false);
+		}
+
+		/**
+		 * @brief		Start connecting a new session to a host.
+		 * @returns		bool	false when the connection couldn't be started, in which case every queued command failed.
+		 */
+		bool open(Host& host)
+		{
+			const auto& target{ *host.target };
+			if (!rcon::password_allowed(target.password)) {
+				fail_queued(host, connection_exception("net::Shard", "Password cannot be blank!", target.hostname, target.port, 0, "Set bAllowBlankPassword in the config to allow it.").what());
+				return false;
+			}
+			addrinfo hints{};
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			hints.ai_protocol = IPPROTO_TCP;
+			addrinfo* info;
+			if (::getaddrinfo(target.hostname.c_str(), target.port.c_str(), &hints, &info) != 0) {
+				fail_queued(host, connection_exception("net::Shard", "Name resolution failed!", target.hostname, target.port, LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage()).what());
+				return false;
+			}
+
+			int fd{ -1 };
+			for (const auto* p{ info }; p != nullptr; p = p->ai_next) {
+				if (fd = ::socket(p->ai_family, p->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, p->ai_protocol); fd == -1)
+					continue;
+				if (::connect(fd, p->ai_addr, p->ai_addrlen) == 0 || errno == EINPROGRESS)
+					break;
+				::close(fd);
+				fd = -1;
+			}
+			::freeaddrinfo(info);
+			if (fd == -1) {
+				fail_queued(host, connection_exception("net::Shard", "Connection Failed.", target.hostname, target.port, LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage()).what());
+				return false;
+			}
+
+			auto& conn{ *host.connections.emplace_back(std::make_unique<Connection>()) };
+			conn.fd = fd;
+			conn.slot = host.slot;
+			conn.generation = host.generation;
+			conn.deadline = std::chrono::steady_clock::now() + TIMEOUT;
+			conn.writing = true;
+			epoll_event ev{ static_cast<uint32_t>(EPOLLIN | EPOLLOUT | EPOLLRDHUP), { .ptr = &conn } };
+			::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+			return true;
+		}
+
+		/// @brief	Send a command on an idle connection.
+		void start(Host& host, Connection& conn, Message* job)
+		{
+			const auto wait{ std::chrono::steady_clock::now() - job->submitted };
+			// an empty command only opens the session
+			if (job->command.empty())
+				return complete(host, job, CommandResult{ true, {}, {}, {} }, wait);
+			conn.job = job;
+			conn.wait = wait;
+			conn.state = State::BUSY;
+			conn.request_id = get_id();
+			conn.terminator_id = get_id();
+			conn.deadline = std::chrono::steady_clock::now() + TIMEOUT;
+			auto& out{ borrow(conn).out };
+			append_packet(out, conn.request_id, packet::Type::SERVERDATA_EXECCOMMAND, job->command);
+			append_packet(out, conn.terminator_id, packet::Type::SERVERDATA_RESPONSE_VALUE, "TERM");
+			flush(host, conn);
+		}
+
+		/// @brief	Send queued commands on idle connections, & open new connections while there are more commands than connections.
+		void dispatch(Host& host)
+		{
+			for (Message* job; (job = host.front()) != nullptr; ) {
+				const auto idle{ std::find_if(host.connections.begin(), host.connections.end(), [](auto&& c) { return c->state == State::IDLE; }) };
+				if (idle != host.connections.end()) {
+					const auto lane{ static_cast<size_t>(job->priority) };
+					host.lanes[lane].pop_front();
+					--host.queued;
+					--host.metrics->lanes[lane].queued;
+					start(host, **idle, job);
+					continue;
+				}
+				size_t opening{ 0ull };
+				for (const auto& conn : host.connections)
+					opening += conn->state == State::CONNECTING || conn->state == State::AUTHENTICATING;
+				if (opening >= host.queued || host.connections.size() >= host.size || !open(host))
+					break;
+			}
+		}
+
+		/// @brief	Remove a host that is being removed once it has no queued or in-flight commands.
+		void try_remove(const size_t slot)
+		{
+			const auto it{ hosts.find(slot) };
+			if (it == hosts.end())
+				return;
+			auto& host{ it->second };
+			if (host.removing == nullptr || host.front() != nullptr || std::any_of(host.connections.begin(), host.connections.end(), [](auto&& c) { return c->job != nullptr; }))
+				return;
+			while (!host.connections.empty())
+				close(host, *host.connections.front());
+			auto* msg{ host.removing };
+			hosts.erase(it);
+			msg->result.set_value({});
+			delete msg;
+		}
+
+		/// @brief	Handle a complete packet received on a connection.
+		void receive(Host& host, Connection& conn, const int id, const int type, std::string_view body)
+		{
+			switch (conn.state) {
+			case State::AUTHENTICATING:
+				// some servers send an empty response value before the authentication response
+				if (type != packet::Type::SERVERDATA_AUTH_RESPONSE)
+					return;
+				if (id != conn.request_id && (!PERMISSIVE_AUTHENTICATION || id == -1))
+					return close(host, conn, badpass_exception(host.target->hostname, host.target->port, 0, "").what());
+				conn.state = State::IDLE;
+				++host.metrics->connected;
+				break;
+			case State::BUSY:
+				if (id == conn.request_id) {
+					conn.buffers->response.append(body.substr(0ull, body.find('\0')));
+					return;
+				}
+				// ignore stray packets, such as the second response some servers send to the terminator
+				if (id != conn.terminator_id)
+					return;
+				{
+					auto* job{ conn.job };
+					conn.job = nullptr;
+					conn.state = State::IDLE;
+					complete(host, job, CommandResult{ true, std::move(conn.buffers->response), {}, {} }, conn.wait);
+					conn.buffers->response.clear();
+				}
+				// reconnect to the new target if the host was retargeted while the command was in flight
+				if (conn.generation != host.generation)
+					close(host, conn);
+				break;
+			default:
+				return;
+			}
+			dispatch(host);
+		}
+
+		/**
+		 * @brief			Parse & handle the packets in data received on a connection.
+		 *\n				Complete packets are handled directly from the data; only an incomplete packet at the end is
+		 *\n				copied to the connection's buffers, to be completed by the next call.
+		 * @param data		The received data.
+		 */
+		void parse(Host& host, Connection& conn, std::string_view data)
+		{
+			const bool buffered{ conn.buffers != nullptr && !conn.buffers->in.empty() };
+			if (buffered)
+				data = conn.buffers->in.append(data);
+
+			size_t pos{ 0ull };
+			while (data.size() - pos >= sizeof(int)) {
+				int fields[3];
+				std::memcpy(fields, data.data() + pos, sizeof(int));
+				if (fields[0] < packet::PSIZE_MIN || fields[0] > packet::PSIZE_MAX)
+					return close(host, conn, socket_exception("net::Shard", "Received a corrupted packet!").what());
+				const auto size{ sizeof(int) + static_cast<size_t>(fields[0]) };
+				if (data.size() - pos < size)
+					break;
+				std::memcpy(fields, data.data() + pos, sizeof(fields));
+				const auto body{ data.substr(pos + sizeof(fields), size - sizeof(fields)) };
+				pos += size;
+				receive(host, conn, fields[1], fields[2], body);
+				if (conn.state == State::CLOSED)
+					return;
+			}
+			if (buffered)
+				conn.buffers->in.erase(0ull, pos);
+			else if (pos < data.size())
+				borrow(conn).in.assign(data.substr(pos));
+		}
+
+		/// @brief	Handle events on a connection.
+		void handle(Connection& conn, const uint32_t events)
+		{
+			if (conn.state == State::CLOSED)
+				return;
+			auto& host{ hosts.at(conn.slot) };
+
+			if (conn.state == State::CONNECTING) {
+				if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) == 0)
+					return;
+				int error{ 0 };
+				socklen_t len{ sizeof(error) };
+				if (::getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0)
+					return close(host, conn, connection_exception("net::Shard", "Connection Failed.", host.target->hostname, host.target->port, error, std::strerror(error)).what());
+				conn.state = State::AUTHENTICATING;
+				conn.request_id = get_id();
+				append_packet(borrow(conn).out, conn.request_id, packet::Type::SERVERDATA_AUTH, host.target->password);
+				return flush(host, conn);
+			}
+
+			if ((events & EPOLLOUT) != 0) {
+				flush(host, conn);
+				if (conn.state == State::CLOSED)
+					return;
+			}
+			if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) == 0)
+				return;
+
+			for (;;) {
+				const auto len{ ::recv(conn.fd, buffer.get(), RECV_BUFFER_SIZE, 0) };
+				if (len > 0) {
+					parse(host, conn, std::string_view{ buffer.get(), static_cast<size_t>(len) });
+					if (conn.state == State::CLOSED)
+						return;
+					if (static_cast<size_t>(len) == RECV_BUFFER_SIZE)
+						continue;
+				}
+				else if (len == 0)
+					return close(host, conn, socket_exception("net::Shard", "Connection closed by server.").what());
+				else if (errno != EAGAIN && errno != EWOULDBLOCK)
+					return close(host, conn, socket_exception("net::Shard", "Connection Lost!", LAST_SOCKET_ERROR_CODE(), getLastSocketErrorMessage()).what());
+				break;
+			}
+			if (conn.state == State::IDLE && conn.buffers != nullptr && conn.buffers->in.empty() && conn.buffers->out.empty())
+				give_back(conn);
+		}
+
+		/// @brief	Handle a message from another thread.
+		void handle(Message* msg)
+		{
+			switch (msg->kind) {
+			case Message::Kind::ADD:
+				hosts.try_emplace(msg->slot, msg->slot, std::move(msg->target), msg->size, msg->metrics);
+				delete msg;
+				break;
+			case Message::Kind::SUBMIT: {
+				auto& host{ hosts.at(msg->slot) };
+				if (is_coalescable(msg->command)) {
+					if (const auto [it, added] { host.inflight.try_emplace(std::make_pair(msg->priority, msg->command)) }; !added) {
+						// an identical command is already queued or in flight; wait for its result instead
+						++host.metrics->coalesced;
+						--host.metrics->lanes[static_cast<size_t>(msg->priority)].queued;
+						it->second.emplace_back(msg);
+						break;
+					}
+					msg->coalesced = true;
+				}
+				host.lanes[static_cast<size_t>(msg->priority)].push_back(msg);
+				++host.queued;
+				dispatch(host);
+				break;
+			}
+			case Message::Kind::RETARGET: {
+				auto& host{ hosts.at(msg->slot) };
+				host.target = std::move(msg->target);
+				++host.generation;
+				delete msg;
+				// connections with a command in flight are closed once it completes
+				for (size_t i{ host.connections.size() }; i > 0ull; --i)
+					if (auto& conn{ *host.connections[i - 1ull] }; conn.job == nullptr)
+						close(host, conn);
+				dispatch(host);
+				break;
+			}
+			case Message::Kind::REMOVE: {
+				const auto slot{ msg->slot };
+				hosts.at(slot).removing = msg;
+				try_remove(slot);
+				break;
+			}
+			}
+		}
+
+		/// @brief	Close connections whose timers have expired.
+		void check_timers()
+		{
+			const auto now{ std::chrono::steady_clock::now() };
+			for (auto& [slot, host] : hosts) {
+				bool expired{ false };
+				for (size_t i{ host.connections.size() }; i > 0ull; --i) {
+					auto& conn{ *host.connections[i - 1ull] };
+					if (conn.state == State::IDLE || conn.deadline > now)
+						continue;
+					// like rcon::exchange(), a command that times out fails without an error
+					close(host, conn, conn.state == State::BUSY ? std::string{} : connection_exception("net::Shard", "Connection timed out.", host.target->hostname, host.target->port, ETIMEDOUT, std::strerror(ETIMEDOUT)).what());
+					expired = true;
+				}
+				if (expired)
+					dispatch(host);
+			}
+		}
+
+		void run()
+		{
+			std::array<epoll_event, 256> events;
+			auto next_check{ std::chrono::steady_clock::now() + TIMER_INTERVAL };
+			while (!stop) {
+				const int count{ ::epoll_wait(epfd, events.data(), static_cast<int>(events.size()), static_cast<int>(TIMER_INTERVAL.count())) };
+				for (int i{ 0 }; i < count; ++i) {
+					if (events[i].data.ptr == nullptr) {
+						uint64_t value;
+						[[maybe_unused]] const auto rc{ ::read(evfd, &value, sizeof(value)) };
+						signaled = false;
+						for (Message* msg; (msg = queue.pop()) != nullptr; )
+							handle(msg);
+					}
+					else handle(*static_cast<Connection*>(events[i].data.ptr), events[i].events);
+				}
+				if (const auto now{ std::chrono::steady_clock::now() }; now >= next_check) {
+					check_timers();
+					next_check = now + TIMER_INTERVAL;
+				}
+				closed.clear();
+				for (const auto& slot : removable)
+					try_remove(slot);
+				removable.clear();
+			}
+			for (auto& [slot, host] : hosts) {
+				while (!host.connections.empty())
+					close(host, *host.connections.front(), "The shard was stopped.");
+				fail_queued(host, "The shard was stopped.");
+			}
+			closed.clear();
+		}
+
+	public:
+		/**
+		 * @brief			Start the shard's thread.
+		 * @throws except	The event loop couldn't be created.
+		 */
+		Shard() : epfd{ ::epoll_create1(EPOLL_CLOEXEC) }, evfd{ ::eventfd(0u, EFD_NONBLOCK | EFD_CLOEXEC) }
+		{
+			epoll_event ev{ static_cast<uint32_t>(EPOLLIN), { .ptr = nullptr } };
+			if (epfd == -1 || evfd == -1 || ::epoll_ctl(epfd, EPOLL_CTL_ADD, evfd, &ev) != 0) {
+				if (epfd != -1)
+					::close(epfd);
+				if (evfd != -1)
+					::close(evfd);
+				throw make_exception("Failed to create a shard's event loop: ", std::strerror(errno));
+			}
+			thread = std::thread{ &Shard::run, this };
+		}
+		Shard(const Shard&) = delete;
+		Shard& operator=(const Shard&) = delete;
+		/// @brief	Stop the shard's thread. Hosts that haven't been removed have their connections closed & queued commands failed.
+		~Shard()
+		{
+			stop = true;
+			wake();
+			if (thread.joinable())
+				thread.join();
+			while (auto* msg{ queue.pop() })
+				delete msg;
+			::close(evfd);
+			::close(epfd);
+		}
+
+		/**
+		 * @brief			Assign a host to the shard.
+		 * @param target	The host's connection information.
+		 * @param size		Maximum number of sessions to the host.
+		 * @param metrics	The metrics to update. Must remain valid until the host is removed.
+		 * @returns			size_t	The host's slot, which identifies it in other calls.
+		 */
+		size_t add(std::shared_ptr<const HostInfo> target, const size_t size, PoolMetrics& metrics)
+		{
+			const auto slot{ next_slot.fetch_add(1ull, std::memory_order_relaxed) };
+			auto* msg{ make_message(Message::Kind::ADD, slot) };
+			msg->target = std::move(target);
+			msg->size = size == 0ull ? 1ull : size;
+			msg->metrics = &metrics;
+			post(msg);
+			return slot;
+		}
+
+		/**
+		 * @brief			Queue a command to be executed by the next available session to a host.
+		 * @param slot		The host's slot.
+		 * @param command	The command to execute. When empty, a session is only opened.
+		 * @param priority	The lane to queue the command in.
+		 * @param metrics	The host's metrics.
+		 * @returns			std::future<CommandResult>
+		 */
+		std::future<CommandResult> submit(const size_t slot, std::string command, const Priority priority, PoolMetrics& metrics)
+		{
+			auto* msg{ make_message(Message::Kind::SUBMIT, slot) };
+			msg->priority = priority;
+			msg->command = std::move(command);
+			msg->submitted = std::chrono::steady_clock::now();
+			auto future{ msg->result.get_future() };
+			++metrics.lanes[static_cast<size_t>(priority)].queued;
+			post(msg);
+			return future;
+		}
+
+		/**
+		 * @brief			Change a host's connection information. Sessions reconnect to the new target after their current command.
+		 * @param slot		The host's slot.
+		 * @param target	The new connection information.
+		 */
+		void retarget(const size_t slot, std::shared_ptr<const HostInfo> target)
+		{
+			auto* msg{ make_message(Message::Kind::RETARGET, slot) };
+			msg->target = std::move(target);
+			post(msg);
+		}
+
+		/**
+		 * @brief		Finish every queued command of a host, then close its sessions & remove it from the shard.
+		 *\n			Blocks until the host has been removed.
+		 * @param slot	The host's slot.
+		 */
+		void remove(const size_t slot)
+		{
+			auto* msg{ make_message(Message::Kind::REMOVE, slot) };
+			auto done{ msg->result.get_future() };
+			post(msg);
+			done.wait();
+		}
+	};
+#else
+	class Shard {
+	public:
+		Shard() { throw make_exception("[--shards] is only supported on Linux!"); }
+		size_t add(std::shared_ptr<const HostInfo>, const size_t, PoolMetrics&) { return 0ull; }
+		std::future<CommandResult> submit(const size_t, std::string, const Priority, PoolMetrics&) { return {}; }
+		void retarget(const size_t, std::shared_ptr<const HostInfo>) {}
+		void remove(const size_t) {}
+	};
+#endif
+}
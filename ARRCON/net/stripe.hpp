@@ -0,0 +1,127 @@
+/**
+ * @file	stripe.hpp
+ * @author	radj307
+ * @brief	Contains the striped commandline mode, which spreads order-independent commands across several connections.
+ */
+#pragma once
+#include "../globals.h"
+#include "../script.hpp"
+#include "session.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mode {
+	/**
+	 * @brief			Execute a list of commands over several authenticated connections to the same target.
+	 *\n				Commands between barriers are executed in no particular order, each by whichever connection
+	 *\n				becomes free first. A "@barrier" line waits for every preceding command to complete before
+	 *\n				any of the following commands are sent.
+	 * @param target	The target server's connection information.
+	 * @param commands	List of commands & directives to execute.
+	 * @param stripes	Number of connections to use.
+	 * @returns			size_t	Number of commands successfully executed.
+	 */
+	inline size_t striped(const net::HostInfo& target, const std::vector<std::string>& commands, const size_t& stripes)
+	{
+		if (stripes == 0ull)
+			throw make_exception("The number of stripes must be greater than 0!");
+
+		std::vector<net::Session> sessions;
+		sessions.reserve(stripes);
+		for (size_t i{ 0ull }; i < stripes; ++i)
+			sessions.emplace_back(target);
+
+		// resolve "@grep" & "@exclude" directives to the command they apply to, since commands may run in any order
+		std::unordered_map<size_t, filter::Filter> local_filters;
+		filter::Filter pending;
+		for (size_t i{ 0ull }; i < commands.size(); ++i) {
+			if (const auto directive{ script::parse_directive(commands[i]) }; !directive.has_value()) {
+				if (!pending.empty()) {
+					local_filters.emplace(i, std::move(pending));
+					pending.clear();
+				}
+			}
+			else if (directive->name == script::directive::GREP)
+				pending.include(directive->args);
+			else if (directive->name == script::directive::EXCLUDE)
+				pending.exclude(directive->args);
+		}
+
+		std::mutex output_mtx;
+		std::atomic<size_t> count{ 0ull };
+
+		// run a single segment (the commands between two barriers) across all sessions
+		const auto run_segment{ [&](const size_t& begin, const size_t& end) {
+			std::atomic<size_t> next{ begin };
+			std::vector<std::thread> workers;
+			workers.reserve(stripes);
+			for (auto& session : sessions) {
+				workers.emplace_back([&]() {
+					std::stringstream buffer;
+					std::string response;
+					for (size_t i{ next++ }; i < end; i = next++) {
+						if (script::is_directive(commands[i]))
+							continue;
+						const auto cmd{ script::unescape(commands[i]) };
+
+						buffer.str({});
+						if (!Global.quiet && !Global.no_prompt)
+							buffer << Global.custom_prompt << Global.palette.set(Color::GREEN) << cmd << Global.palette.reset() << '\n';
+
+						const auto local{ local_filters.find(i) };
+						response.clear();
+						bool ok{ false }, stop{ false };
+						try {
+							// sessions are closed when a command times out or the connection is lost
+							if (!session.is_open())
+								session.open(target);
+							ok = session.exchange(cmd, [&buffer, &response, &local, &local_filters](const net::packet::Packet& p) {
+								if (!Global.quiet)
+									print_packet(buffer, p, local != local_filters.end() ? &local->second : nullptr);
+								if (net::feed::feed.is_open())
+									response += p.body;
+							});
+						} catch (const connection_except& ex) {
+							// the session couldn't be reopened, so this connection stops; the others run the remaining commands
+							buffer << Global.palette.get_error() << ex.what() << '\n';
+							stop = true;
+						} catch (const std::exception& ex) {
+							session.close();
+							buffer << Global.palette.get_error() << ex.what() << '\n';
+						}
+						count += static_cast<size_t>(ok);
+						net::feed::feed.publish_response(target.hostname, cmd, response);
+
+						if (const auto output{ buffer.str() }; !output.empty()) {
+							// write the whole response at once so responses from different connections don't interleave
+							std::scoped_lock lock(output_mtx);
+							(std::cout << output << Global.palette.reset()).flush();
+						}
+						if (stop)
+							return;
+						std::this_thread::sleep_for(Global.command_delay.load());
+					}
+				});
+			}
+			for (auto& worker : workers)
+				worker.join();
+		} };
+
+		size_t segment_begin{ 0ull };
+		for (size_t i{ 0ull }; i < commands.size(); ++i) {
+			if (const auto directive{ script::parse_directive(commands[i]) }; directive.has_value() && directive->name == script::directive::BARRIER) {
+				run_segment(segment_begin, i);
+				segment_begin = i + 1ull;
+			}
+		}
+		run_segment(segment_begin, commands.size());
+
+		return count.load();
+	}
+}
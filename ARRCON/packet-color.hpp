@@ -5,10 +5,14 @@
  */
 #pragma once
 #include "net/objects/packet.hpp"
+#include "filter.hpp"
+#include "encoding.hpp"
 #include <Sequence.hpp>
 #include <color-values.h>
 #include <setcolor.hpp>
 
+#include <string_view>
+
 
 namespace mc_color {
 	inline ANSI::sequence to_sequence(const char& ch)
@@ -63,30 +67,82 @@ namespace mc_color {
 }
 
 /**
- * @brief			Packet stream insertion operator.
+ * @brief			Render a response body, converting Minecraft color codes to ANSI sequences when enabled.
+ *\n				A trailing newline is added when the body doesn't already end with one.
  * @param os		Output Stream.
- * @param packet	Packet instance.
+ * @param body		Response text, which must already be valid UTF-8. See encoding::to_utf8().
  * @returns			std::ostream&
  */
-inline std::ostream& operator<<(std::ostream& os, const net::packet::Packet& packet)
+inline std::ostream& print_body(std::ostream& os, const std::string_view& body)
 {
 	if (Global.enable_bukkit_color_support) {
-		for (auto ch{ packet.body.begin() }; ch != packet.body.end(); ++ch) {
-			switch (*ch) {
-			case -62: // discard first part of section sign when represented in ASCII
-				break;
-			case -89: // '�' // second part of ASCII section sign
-				if (std::distance(ch, packet.body.end()) > static_cast<std::ptrdiff_t>(1))
-					os << mc_color::to_sequence(*++ch);
-				break;
-			default:
-				os << *ch;
-				break;
+		for (size_t i{ 0ull }; i < body.size(); ++i) {
+			// section sign (U+00A7) followed by a color code
+			if (body[i] == '\xC2' && i + 2ull < body.size() && body[i + 1ull] == '\xA7') {
+				os << mc_color::to_sequence(body[i + 2ull]);
+				i += 2ull;
 			}
+			else os << body[i];
 		}
 	}
-	else os << packet.body;
-	if (!packet.body.empty() && packet.body.back() != '\n')
+	else os << body;
+	if (!body.empty() && body.back() != '\n')
 		os << '\n'; // print newline if packet doesn't already have one
-	return os.flush();
+	return os;
+}
+
+/**
+ * @brief			Print a packet, showing only the lines that pass the global [--grep]/[--exclude] filter & an optional local filter.
+ *\n				The body is converted to UTF-8 from the [--encoding] first, so filters & colors always see valid text.
+ * @param os		Output Stream.
+ * @param packet	Packet instance.
+ * @param local		Optional filter that only applies to this packet, such as one specified with script directives.
+ * @returns			std::ostream&
+ */
+inline std::ostream& print_packet(std::ostream& os, const net::packet::Packet& packet, const filter::Filter* local = nullptr)
+{
+	thread_local std::string converted;
+	const auto body{ encoding::to_utf8(packet.body, Global.encoding, converted) };
+
+	if (Global.filter.empty() && (local == nullptr || local->empty()))
+		return print_body(os, body).flush();
+
+	thread_local std::string selected;
+	selected.clear();
+	filter::for_each_line(body, [&local](const std::string_view& line) {
+		if (Global.filter.passes(line) && (local == nullptr || local->passes(line))) {
+			selected += line;
+			selected += '\n';
+		}
+	});
+	return print_body(os, selected).flush();
+}
+
+/**
+ * @brief			Append the lines of a packet that pass the global [--grep]/[--exclude] filter & an optional local filter
+ *\n				to a string as plain UTF-8 text, without color codes. Used when writing responses to files.
+ * @param out		Output string.
+ * @param packet	Packet instance.
+ * @param local		Optional filter that only applies to this packet.
+ */
+inline void append_plain(std::string& out, const net::packet::Packet& packet, const filter::Filter* local = nullptr)
+{
+	thread_local std::string converted, stripped;
+	filter::for_each_line(encoding::to_utf8(packet.body, Global.encoding, converted), [&out, &local](const std::string_view& line) {
+		if (Global.filter.passes(line) && (local == nullptr || local->passes(line))) {
+			out += filter::strip_colors(line, stripped);
+			out += '\n';
+		}
+	});
+}
+
+/**
+ * @brief			Packet stream insertion operator.
+ * @param os		Output Stream.
+ * @param packet	Packet instance.
+ * @returns			std::ostream&
+ */
+inline std::ostream& operator<<(std::ostream& os, const net::packet::Packet& packet)
+{
+	return print_packet(os, packet);
 }
@@ -0,0 +1,199 @@
+/**
+ * @file	script.hpp
+ * @author	radj307
+ * @brief	Contains the script directive parser.
+ *\n		Directives are lines beginning with '@' that control how a script is executed, rather than being sent to the server.
+ *\n		Lines beginning with "@@" are commands that begin with a literal '@'; the first '@' is removed before they're sent.
+ */
+#pragma once
+#include <make_exception.hpp>
+#include <str.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+ /**
+  * @namespace	script
+  * @brief		Contains functions & objects related to script directives.
+  */
+namespace script {
+	/// @brief	The character that marks a line as a directive.
+	inline constexpr const char DIRECTIVE_PREFIX{ '@' };
+
+	/**
+	 * @namespace	directive
+	 * @brief		Contains the names of all recognized directives.
+	 */
+	namespace directive {
+		inline constexpr const auto
+			// Waits for all preceding commands to complete before continuing. (Only affects striped execution)
+			BARRIER{ "barrier" },
+			// Waits until a response matches a regular expression, then branches or aborts.
+			EXPECT{ "expect" },
+			// Marks a position in the script that can be jumped to.
+			LABEL{ "label" },
+			// Jumps to a label.
+			GOTO{ "goto" },
+			// Only shows lines of the next command's response that match a pattern.
+			GREP{ "grep" },
+			// Hides lines of the next command's response that match a pattern.
+			EXCLUDE{ "exclude" };
+
+		/// @brief	Every recognized directive name.
+		inline constexpr const char* const ALL[]{ BARRIER, EXPECT, LABEL, GOTO, GREP, EXCLUDE };
+
+		/**
+		 * @brief		Check if the given name is a recognized directive.
+		 * @param name	A directive name, excluding the prefix.
+		 * @returns		bool
+		 */
+		inline bool is_known(const std::string& name)
+		{
+			return std::any_of(std::begin(ALL), std::end(ALL), [&name](const char* known) { return name == known; });
+		}
+	}
+
+	/**
+	 * @struct	Directive
+	 * @brief	A parsed directive line.
+	 */
+	struct Directive {
+		/// @brief	The directive's name, excluding the prefix.
+		std::string name;
+		/// @brief	Everything after the name, with surrounding whitespace removed.
+		std::string args;
+	};
+
+	/**
+	 * @brief		Check if the given line is a directive. Lines beginning with an escaped prefix ("@@") aren't directives.
+	 * @param line	A line from a script.
+	 * @returns		bool
+	 */
+	inline bool is_directive(const std::string& line)
+	{
+		return !line.empty() && line.front() == DIRECTIVE_PREFIX && (line.size() == 1ull || line[1] != DIRECTIVE_PREFIX);
+	}
+
+	/**
+	 * @brief		Get the command to send for a line that isn't a directive, removing the escape from a leading "@@".
+	 * @param line	A line from a script.
+	 * @returns		std::string
+	 */
+	inline std::string unescape(const std::string& line)
+	{
+		if (line.size() >= 2ull && line[0] == DIRECTIVE_PREFIX && line[1] == DIRECTIVE_PREFIX)
+			return line.substr(1ull);
+		return line;
+	}
+
+	/**
+	 * @brief		Parse a directive line.
+	 * @param line	A line from a script.
+	 * @returns		std::optional<Directive>
+	 *\n			std::nullopt when the line isn't a directive.
+	 */
+	inline std::optional<Directive> parse_directive(const std::string& line)
+	{
+		if (!is_directive(line))
+			return std::nullopt;
+		const auto split{ line.find_first_of(" \t", 1ull) };
+		if (split == std::string::npos)
+			return Directive{ line.substr(1ull), {} };
+		return Directive{ line.substr(1ull, split - 1ull), str::strip_line(line.substr(split + 1ull)) };
+	}
+
+	/**
+	 * @brief			Check that a line isn't an unrecognized directive, which would otherwise be skipped silently.
+	 * @param line		A line from a script.
+	 * @param location	Where the line came from, for the error message. (e.g. "line 3 of \"script.txt\"")
+	 * @throws except	The line is a directive with an unrecognized name.
+	 */
+	inline void validate(const std::string& line, const std::string& location)
+	{
+		if (const auto d{ parse_directive(line) }; d.has_value() && !directive::is_known(d->name))
+			throw make_exception("Unknown directive \"", DIRECTIVE_PREFIX, d->name, "\" on ", location, "! Use \"", DIRECTIVE_PREFIX, DIRECTIVE_PREFIX, "\" to send a command that begins with '", DIRECTIVE_PREFIX, "'.");
+	}
+
+	/**
+	 * @struct	Expect
+	 * @brief	A parsed "@expect" directive.
+	 *\n		Syntax:  @expect <timeout ms> /<regex>/ [then <label>] [else <label>|continue|abort]
+	 *\n		The regular expression is matched against the previous command's response, and against any
+	 *\n		packets that arrive afterwards until the timeout expires. When it matches, execution continues
+	 *\n		at the "then" label (or the next line); otherwise it continues at the "else" label, continues
+	 *\n		with the next line, or aborts the script. (The default is to abort.)
+	 */
+	struct Expect {
+		inline static constexpr const auto CONTINUE{ "continue" }, ABORT{ "abort" };
+
+		std::chrono::milliseconds timeout;
+		std::string pattern_string;
+		std::regex pattern;
+		std::string then_target;
+		std::string else_target{ ABORT };
+
+		/**
+		 * @brief			Parse the arguments of an "@expect" directive.
+		 * @param args		The directive's arguments.
+		 * @throws except	The arguments are invalid.
+		 */
+		Expect(const std::string& args)
+		{
+			const auto fail{ [&args](auto&&... message) {
+				return make_exception("Invalid @expect directive \"", args, "\": ", message..., "\n  Syntax:  @expect <timeout ms> /<regex>/ [then <label>] [else <label>|continue|abort]");
+			} };
+
+			const auto space{ args.find_first_of(" \t") };
+			const auto timeout_str{ args.substr(0ull, space) };
+			if (timeout_str.empty() || !std::all_of(timeout_str.begin(), timeout_str.end(), isdigit))
+				throw fail("expected a timeout in milliseconds.");
+			timeout = std::chrono::milliseconds{ std::stoll(timeout_str) };
+
+			const auto open{ args.find('/', space) }, close{ args.rfind('/') };
+			if (space == std::string::npos || open == std::string::npos || close == open)
+				throw fail("expected a regular expression enclosed in slashes.");
+			pattern_string = args.substr(open + 1ull, close - open - 1ull);
+			try {
+				pattern = std::regex{ pattern_string, std::regex::ECMAScript | std::regex::optimize };
+			} catch (const std::regex_error& ex) {
+				throw fail("the regular expression is invalid: ", ex.what());
+			}
+
+			std::stringstream ss{ args.substr(close + 1ull) };
+			for (std::string keyword, target; ss >> keyword; ) {
+				if (!(ss >> target))
+					throw fail("expected a target after \"", keyword, "\".");
+				if (keyword == "then")
+					then_target = target;
+				else if (keyword == "else")
+					else_target = target;
+				else throw fail("unrecognized keyword \"", keyword, "\".");
+			}
+		}
+	};
+
+	/**
+	 * @brief			Find the positions of all "@label" directives in a script.
+	 * @param commands	The script's lines.
+	 * @throws except	A label is defined more than once.
+	 * @returns			std::unordered_map<std::string, size_t>
+	 *\n				Map of label names to the index of their directive.
+	 */
+	inline std::unordered_map<std::string, size_t> find_labels(const std::vector<std::string>& commands)
+	{
+		std::unordered_map<std::string, size_t> labels;
+		for (size_t i{ 0ull }; i < commands.size(); ++i) {
+			if (const auto d{ parse_directive(commands[i]) }; d.has_value() && d->name == directive::LABEL) {
+				if (!labels.emplace(d->args, i).second)
+					throw make_exception("Label \"", d->args, "\" is defined more than once!");
+			}
+		}
+		return labels;
+	}
+}
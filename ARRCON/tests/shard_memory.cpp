@@ -0,0 +1,206 @@
+/**
+ * @file	shard_memory.cpp
+ * @author	radj307
+ * @brief	Opens many idle sharded sessions against a stub RCON server in the same process, & checks the heap memory used by each one.
+ *\n		Everything that the pool registry allocates for a host is counted: its shared connection information, its HostPool
+ *\n		& registry entries, the shard's host slot, & the idle connection. Only the shards' fixed receive buffers are excluded.
+ *\n		Exits with a non-zero code when an idle session uses more than MAX_BYTES_PER_SESSION.
+ */
+#include "../net/pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <poll.h>
+#include <sys/resource.h>
+#include <vector>
+
+/// @brief	Number of bytes currently allocated with operator new. The size of each allocation is stored in a header before it.
+static std::atomic<long long> heap_usage{ 0ll };
+
+void* operator new(std::size_t size)
+{
+	void* p{ std::malloc(size + alignof(std::max_align_t)) };
+	if (p == nullptr)
+		throw std::bad_alloc{};
+	*static_cast<std::size_t*>(p) = size;
+	heap_usage += static_cast<long long>(size);
+	return static_cast<char*>(p) + alignof(std::max_align_t);
+}
+void operator delete(void* p) noexcept
+{
+	if (p == nullptr)
+		return;
+	auto* base{ static_cast<char*>(p) - alignof(std::max_align_t) };
+	heap_usage -= static_cast<long long>(*reinterpret_cast<std::size_t*>(base));
+	std::free(base);
+}
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+
+/**
+ * @brief	Maximum heap memory that an idle sharded session may use.
+ *\n		With libstdc++ on x86-64, a session currently uses about 860 bytes:
+ *\n		  192	The registry's map entry & shared HostInfo.
+ *\n		  344	The registry's pool map & lookup snapshot entries, & the HostPool itself, which is mostly its PoolMetrics.
+ *\n		  210	The shard's host slot.
+ *\n		  114	The idle connection.
+ *\n		The limit leaves room for other standard libraries, but fails if per-session state that scales with the pool size,
+ *\n		such as the worker-thread state that sharded pools don't allocate, is added back.
+ */
+static constexpr const long long MAX_BYTES_PER_SESSION{ 1024ll };
+/// @brief	Number of sessions to open, unless the open file limit is too low.
+static constexpr const size_t SESSIONS{ 1000ull };
+/// @brief	Number of shards that the sessions are spread across.
+static constexpr const size_t SHARDS{ 4ull };
+
+/**
+ * @class	StubServer
+ * @brief	A minimal RCON server that accepts any password & answers every command with an empty response.
+ *\n		All of its memory is allocated by the constructor, so it doesn't affect the measurements.
+ */
+class StubServer {
+	struct Client {
+		int fd{ -1 };
+		size_t len{ 0ull };
+		char in[512]{};
+	};
+
+	SOCKET listener;
+	std::vector<Client> clients;
+	std::vector<pollfd> fds;
+	std::atomic<bool> stop{ false };
+	std::thread thread;
+
+	static void send_packet(const int& fd, const int32_t& id, const int32_t& type)
+	{
+		char out[14]{};
+		const int32_t size{ 10 };
+		std::memcpy(out, &size, 4);
+		std::memcpy(out + 4, &id, 4);
+		std::memcpy(out + 8, &type, 4);
+		(void)!::send(fd, out, sizeof(out), MSG_NOSIGNAL);
+	}
+
+	/// @brief	Answer every complete packet in a client's buffer.
+	static void handle(Client& client)
+	{
+		size_t pos{ 0ull };
+		for (int32_t size, id, type; client.len - pos >= 12ull; pos += 4ull + static_cast<size_t>(size)) {
+			std::memcpy(&size, client.in + pos, 4);
+			if (client.len - pos < 4ull + static_cast<size_t>(size))
+				break;
+			std::memcpy(&id, client.in + pos + 4, 4);
+			std::memcpy(&type, client.in + pos + 8, 4);
+			if (type == net::packet::Type::SERVERDATA_AUTH) {
+				send_packet(client.fd, id, net::packet::Type::SERVERDATA_RESPONSE_VALUE);
+				send_packet(client.fd, id, net::packet::Type::SERVERDATA_AUTH_RESPONSE);
+			}
+			else send_packet(client.fd, id, net::packet::Type::SERVERDATA_RESPONSE_VALUE);
+		}
+		client.len -= pos;
+		std::memmove(client.in, client.in + pos, client.len);
+	}
+
+	void run()
+	{
+		while (!stop) {
+			if (::poll(fds.data(), fds.size(), 50) <= 0)
+				continue;
+			if ((fds[0].revents & POLLIN) != 0 && fds.size() < fds.capacity()) {
+				if (const int fd{ ::accept(listener, nullptr, nullptr) }; fd != -1) {
+					clients.emplace_back().fd = fd;
+					fds.emplace_back(pollfd{ fd, POLLIN, 0 });
+				}
+			}
+			for (size_t i{ 1ull }; i < fds.size(); ++i) {
+				if ((fds[i].revents & POLLIN) == 0)
+					continue;
+				auto& client{ clients[i - 1ull] };
+				if (const auto n{ ::recv(client.fd, client.in + client.len, sizeof(client.in) - client.len, 0) }; n > 0) {
+					client.len += static_cast<size_t>(n);
+					handle(client);
+				}
+				else fds[i].fd = -1;
+			}
+		}
+	}
+
+public:
+	StubServer(const size_t& capacity) : listener{ net::listen("127.0.0.1", "0", 4096) }
+	{
+		clients.reserve(capacity);
+		fds.reserve(capacity + 1ull);
+		fds.emplace_back(pollfd{ static_cast<int>(listener), POLLIN, 0 });
+		thread = std::thread{ &StubServer::run, this };
+	}
+	~StubServer()
+	{
+		stop = true;
+		thread.join();
+		for (const auto& client : clients)
+			::close(client.fd);
+		net::close_socket(listener);
+	}
+
+	/// @brief	Get the port that the server is listening on.
+	std::string port() const
+	{
+		sockaddr_in addr{};
+		socklen_t len{ sizeof(addr) };
+		getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+		return std::to_string(ntohs(addr.sin_port));
+	}
+};
+
+int main()
+{
+	// each session uses 2 file descriptors; one for the client & one for the stub server
+	rlimit limit{};
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, 4096);
+	setrlimit(RLIMIT_NOFILE, &limit);
+	const size_t count{ std::min<size_t>(SESSIONS, (static_cast<size_t>(limit.rlim_cur) - 64ull) / 2ull) };
+
+	StubServer server{ count };
+	std::map<std::string, net::HostInfo> targets;
+	for (size_t i{ 0ull }; i < count; ++i)
+		targets.emplace("host" + std::to_string(i), net::HostInfo{ "127.0.0.1", server.port(), "password" });
+
+	std::vector<net::HostPool*> pools;
+	pools.reserve(count);
+	std::vector<std::future<net::CommandResult>> results;
+	results.reserve(count);
+
+	// the shards' receive buffers don't depend on the number of sessions
+	long long fixed{ 0ll };
+	{
+		const auto before{ heap_usage.load() };
+		net::PoolRegistry empty{ {}, 1ull, SHARDS };
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+		fixed = heap_usage.load() - before;
+	}
+
+	const auto before{ heap_usage.load() };
+	net::PoolRegistry registry{ targets, 1ull, SHARDS };
+	for (const auto& [name, _] : targets)
+		pools.emplace_back(registry.get(name));
+
+	for (auto* pool : pools)
+		results.emplace_back(pool->submit("test"));
+	for (auto& result : results) {
+		if (const auto r{ result.get() }; !r.ok) {
+			std::cerr << "A command failed: " << r.error << std::endl;
+			return 1;
+		}
+	}
+	results.clear();
+	std::this_thread::sleep_for(std::chrono::milliseconds{ 250 });
+	const auto per_session{ (heap_usage.load() - before - fixed) / static_cast<long long>(count) };
+
+	std::cout << count << " idle sharded sessions use " << per_session << " bytes of heap memory each (limit: " << MAX_BYTES_PER_SESSION << ")" << std::endl;
+	return per_session <= MAX_BYTES_PER_SESSION ? 0 : 1;
+}
@@ -9,6 +9,8 @@
 #include "config.hpp"			///< INI functions
 #include "exceptions.hpp"
 #include "net/objects/HostInfo.hpp"
+#include "script.hpp"
+#include "watcher.hpp"
 
 #include <filei.hpp>
 #include <fileutil.hpp>
@@ -55,6 +57,8 @@ public:
 			<< "  -P, --port  <Port>          RCON Server Port.         (Default: \"" << Global.DEFAULT_TARGET.port + "\")" << '\n'
 			<< "  -p, --pass  <Pass>          RCON Server Password." << '\n'
 			<< "  -S, --saved <Host>          Use a saved host's connection information, if it isn't overridden by arguments." << '\n'
+			<< "                               Specify more than once to keep sessions open to several hosts at once; use the" << '\n'
+			<< "                               \":use <host>\", \":all <command>\" & \":hosts\" meta-commands to switch between them." << '\n'
 			<< "      --save-host <H>         Create a new saved host named \"<H>\" using the current [Host/Port/Pass] value(s)." << '\n'
 			<< "      --remove-host <H>       Remove an existing saved host named \"<H>\" from the list, then exit." << '\n'
 			<< "  -l, --list-hosts            Show a list of all saved hosts, then exit." << '\n'
@@ -67,10 +71,57 @@ public:
 			<< "  -w, --wait <ms>             Wait for \"<ms>\" milliseconds between sending each command in mode [2]." << '\n'
 			<< "  -n, --no-color              Disable colorized console output." << '\n'
 			<< "  -Q, --no-prompt             Disables the prompt in interactive mode, and command echo in commandline mode." << '\n'
+			<< "      --encoding <E>          Interpret responses as \"utf8\", \"latin1\", \"cp1252\", or \"auto\" & convert them to UTF-8." << '\n'
+			<< "                               Invalid characters are replaced with U+FFFD.  (Default: \"auto\")" << '\n'
 			<< "      --print-env             Prints all recognized environment variables, their values, and descriptions." << '\n'
 			<< "      --write-ini             (Over)write the INI file with the default configuration values & exit." << '\n'
 			<< "      --update-ini            Writes the current configuration values to the INI file, and adds missing keys." << '\n'
 			<< "  -f, --file <file>           Load the specified file and run each line as a command." << '\n'
+			<< "      --output-dir <dir>      Write each target's responses to \"<dir>/<name>.log\" instead of the terminal, then exit." << '\n'
+			<< "                               Specify [-S|--saved] more than once to run the commands on several hosts at once." << '\n'
+			<< "      --shm <name>            Publish every response to the shared memory ring buffer \"<name>\" for local readers." << '\n'
+			<< "                               See net/feed.hpp for the layout.  Use --shm-size <KiB> to set its size.  (Default: 4096)" << '\n'
+			<< "      --gateway <port>        Serve an HTTP/JSON API on 127.0.0.1:<port> for every saved host, & \"default\"." << '\n'
+			<< "                               POST /hosts/<name>/command executes {\"command\":\"<command>\"} (application/json)." << '\n'
+			<< "                               Add \"?priority=high\" or \"?priority=low\" to move it ahead of or behind other commands." << '\n'
+			<< "      --upgrade-socket <path> Used with [--gateway] to upgrade without dropping connections. A new gateway started" << '\n'
+			<< "                               with the same path takes over the running one's port & sessions.  (Linux only)" << '\n'
+			<< "      --pool-size <N>         Number of sessions kept open to each host by [--gateway] & [--schedule].  (Default: 2)" << '\n'
+			<< "      --shards <N>            Drive the sessions of [--gateway] & [--schedule] from <N> event loop threads instead of" << '\n'
+			<< "                               a thread per session; each host is owned by one of them.  (Linux only)" << '\n'
+			<< "      --serve-stdio           Read newline-delimited JSON-RPC requests from STDIN & write the responses to STDOUT." << '\n'
+			<< "                               Methods are \"connect\", \"command\" & \"close\"; see net/serve.hpp for details." << '\n'
+			<< "      --schedule <file>       Run the jobs in \"<file>\" at the times given by their cron expressions, keeping" << '\n'
+			<< "                               sessions open between runs.  See net/schedule.hpp for the file format." << '\n'
+			<< "      --grep <pattern>        Only show response lines that match \"<pattern>\". Can be specified multiple times." << '\n'
+			<< "      --exclude <pattern>     Hide response lines that match \"<pattern>\". Can be specified multiple times." << '\n'
+			<< "                               Patterns are regular expressions, matched without color codes." << '\n'
+			<< "      --lua <file>            Run a Lua script over a single session. Commandline parameters are passed to" << '\n'
+			<< "                               the script in the \"arg\" table. (Requires a build with ARRCON_ENABLE_LUA)" << '\n'
+			<< "      --template <T>          Execute template \"<T>\" once per row of [--csv] or [--tsv], replacing each {column}" << '\n'
+			<< "                               with the row's value. Columns are named by the header row, or by index." << '\n'
+			<< "      --csv <file>            Comma-separated input for [--template]. Use \"-\" to read from STDIN." << '\n'
+			<< "      --tsv <file>            Tab-separated input for [--template]. Use \"-\" to read from STDIN." << '\n'
+			<< "      --checkpoint <file>     Record script progress in \"<file>\" so that an interrupted run can be resumed." << '\n'
+			<< "      --resume                Skip commands that were already completed according to [--checkpoint]." << '\n'
+			<< "      --stripe <K>            Spread the commands across \"<K>\" connections without preserving their order, then exit." << '\n'
+			<< "                               Lines containing \"@barrier\" wait for all preceding commands to complete." << '\n'
+			<< '\n'
+			<< "DIAGNOSTIC OPTIONS:\n"
+			<< "      --bench <N>             Run the given command(s) \"<N>\" times in serial, pipelined & parallel benchmarks," << '\n'
+			<< "                               then print throughput & latency percentiles and exit." << '\n'
+			<< "      --concurrency <C>       Number of connections to use for parallel benchmarks.  (Default: 4)" << '\n'
+			<< "      --load <M>              Generate load over \"<M>\" concurrent sessions, reporting the achieved rate," << '\n'
+			<< "                               errors & latency every second, then exit." << '\n'
+			<< "      --rate <R>              Target total command rate for [--load], in commands per second.  (Default: unlimited)" << '\n'
+			<< "      --duration <S>          Number of seconds to generate load for.  (Default: 60)" << '\n'
+			<< "      --mix <file>            Load a weighted command mix from \"<file>\", one \"<weight> <command>\" per line." << '\n'
+			<< "      --record <file>         Record every sent & received packet to \"<file>\" with timestamps." << '\n'
+			<< "      --replay <file>         Play back a recording as a fake server on [-P|--port] of 127.0.0.1, or [-H|--host], then exit." << '\n'
+			<< "      --replay-speed <N>      Play back recordings at \"<N>\"x the original speed.  (Default: 1)" << '\n'
+			<< "      --flight-dump <file>    Append the flight recorder (recent network events) to \"<file>\" on errors," << '\n'
+			<< "                               timeouts, fatal exits, and SIGQUIT.  (Default: \"ARRCON.flight\" in the config directory)" << '\n'
+			<< "                               Errors trigger at most 1 dump every 10 seconds, & the file is rotated at 4 MB." << '\n'
 			;
 	}
 };
@@ -106,6 +157,89 @@ inline net::HostInfo resolveTargetInfo(const opt3::ArgManager& args, const net::
 	};
 }
 
+/**
+ * @brief			Resolve every target specified with [-S|--saved], for modes that connect to more than one host.
+ *\n				When no more than one saved host is specified, the result contains only the primary target.
+ * @param args		Commandline argument container.
+ * @param saved		The saved host list.
+ * @param primary	The target returned by resolveTargetInfo().
+ * @throws except	A saved host doesn't exist.
+ * @returns			std::vector<std::pair<std::string, net::HostInfo>>
+ *\n				Pairs of display names & connection information, in the order they were specified.
+ */
+inline std::vector<std::pair<std::string, net::HostInfo>> resolveSavedTargets(const opt3::ArgManager& args, const net::HostList& saved, const net::HostInfo& primary)
+{
+	const auto names{ args.getv_all<opt3::Flag, opt3::Option>('S', "saved") };
+	if (names.size() <= 1ull)
+		return{ std::make_pair(names.empty() ? primary.hostname + '_' + primary.port : names.front(), primary) };
+
+	std::vector<std::pair<std::string, net::HostInfo>> targets;
+	targets.reserve(names.size());
+	for (const auto& name : names) {
+		if (const auto it{ saved.find(name) }; it != saved.end())
+			targets.emplace_back(name, net::HostInfo{ it->second, Global.DEFAULT_TARGET });
+		else throw make_exception("There is no saved target named ", Global.palette.set_or(Color::YELLOW, '\"'), name, Global.palette.reset_or('\"'), " in the hosts file!");
+	}
+	return targets;
+}
+
+/**
+ * @brief			Get the connection information of every saved target, & of the primary target as "default".
+ * @param saved		The saved targets.
+ * @param primary	The primary target.
+ * @returns			std::map<std::string, net::HostInfo>
+ */
+inline std::map<std::string, net::HostInfo> getAllTargets(const net::HostList& saved, const net::HostInfo& primary)
+{
+	std::map<std::string, net::HostInfo> targets;
+	for (const auto& [name, section] : saved)
+		targets.emplace(name, net::HostInfo{ section, Global.DEFAULT_TARGET });
+	targets.emplace("default", primary);
+	return targets;
+}
+
+/**
+ * @brief				Watch the config & hosts files, & apply changes to them while a long-running mode is active.
+ *\n					Changes to the config's timing settings are applied to the Global object; see config::reload_ini.
+ * @param ini_path		Location of the config file.
+ * @param hostfile_path	Location of the hosts file.
+ * @param on_hosts		Called with the connection information of every host (see getAllTargets) when the hosts file changes.
+ * @returns				std::unique_ptr<FileWatcher>
+ */
+inline std::unique_ptr<FileWatcher> watchConfig(const std::filesystem::path& ini_path, const std::filesystem::path& hostfile_path, std::function<void(std::map<std::string, net::HostInfo>)> on_hosts)
+{
+	return std::make_unique<FileWatcher>(std::vector<std::filesystem::path>{ ini_path, hostfile_path }, [ini_path, hostfile_path, on_hosts](const std::filesystem::path& path) {
+		if (path == ini_path) {
+			// parse errors are thrown to the watcher, which prints them
+			if (config::reload_ini(ini_path))
+				std::cerr << Global.palette.get_msg() << "Reloaded " << ini_path << std::endl;
+			else std::cerr << Global.palette.get_warn() << "Didn't reload " << ini_path << " because it is missing or empty; keeping the current settings." << std::endl;
+		}
+		else if (path == hostfile_path) {
+			on_hosts(getAllTargets(file::exists(hostfile_path) ? net::HostList{ hostfile_path } : net::HostList{}, Global.target));
+			std::cerr << Global.palette.get_msg() << "Reloaded " << hostfile_path << std::endl;
+		}
+	});
+}
+
+/**
+ * @brief			Get the value of a long option that accepts a positive integer.
+ * @param args		Commandline argument container.
+ * @param name		The name of the option, excluding the preceding dashes.
+ * @throws except	The captured value isn't a valid positive integer.
+ * @returns			std::optional<size_t>
+ *\n				std::nullopt when the option wasn't specified.
+ */
+inline std::optional<size_t> getv_count(const opt3::ArgManager& args, const std::string& name)
+{
+	if (const auto arg{ args.getv<opt3::Option>(name) }; arg.has_value()) {
+		if (!arg.value().empty() && std::all_of(arg.value().begin(), arg.value().end(), isdigit))
+			return static_cast<size_t>(str::stoll(arg.value()));
+		throw make_exception("Invalid value given to --", name, ": \"", arg.value(), "\", expected a positive integer.");
+	}
+	return std::nullopt;
+}
+
 /**
  * @brief			Reads the target file and returns a vector of command strings for each valid line.
  * @param filename	Target Filename
@@ -124,9 +258,14 @@ inline std::vector<std::string> read_script_file(std::string filename, const env
 		std::vector<std::string> commands;
 		commands.reserve(file::count(fss, '\n') + 1ull);
 
-		for (std::string lnbuf{}; std::getline(fss, lnbuf, '\n'); )
-			if (lnbuf = str::strip_line(lnbuf, "#;"); !lnbuf.empty())
+		size_t line{ 0ull };
+		for (std::string lnbuf{}; std::getline(fss, lnbuf, '\n'); ) {
+			++line;
+			if (lnbuf = str::strip_line(lnbuf, "#;"); !lnbuf.empty()) {
+				script::validate(lnbuf, "line " + std::to_string(line) + " of \"" + filename + '\"');
 				commands.emplace_back(lnbuf);
+			}
+		}
 
 		commands.shrink_to_fit();
 		return commands;
@@ -142,13 +281,21 @@ inline std::vector<std::string> read_script_file(std::string filename, const env
 inline std::vector<std::string> get_commands(const opt3::ArgManager& args, const env::PATH& pathvar)
 {
 	std::vector<std::string> commands{ args.getv_all<opt3::Parameter>() }; // Arg<std::string> is implicitly convertable to std::string
+	for (size_t i{ 0ull }; i < commands.size(); ++i)
+		script::validate(commands[i], "commandline parameter " + std::to_string(i + 1ull));
 
-	// Check for piped data on STDIN
-	if (hasPendingDataSTDIN()) {
+	// Check for piped data on STDIN, unless it's being used as the input for [--template] or the requests for [--serve-stdio]
+	const bool stdinIsTemplateInput{ args.getv<opt3::Option>("csv").value_or("") == "-" || args.getv<opt3::Option>("tsv").value_or("") == "-" };
+	const bool stdinIsServerInput{ args.check<opt3::Option>("serve-stdio") };
+	if (!stdinIsTemplateInput && !stdinIsServerInput && hasPendingDataSTDIN()) {
+		size_t line_number{ 0ull };
 		for (std::string ln{}; str::getline(std::cin, ln, '\n'); ) {
+			++line_number;
 			ln = str::strip_line(ln); // remove preceeding & trailing whitespace
-			if (!ln.empty())
+			if (!ln.empty()) {
+				script::validate(ln, "line " + std::to_string(line_number) + " of STDIN");
 				commands.emplace_back(ln); // read all available lines from STDIN into the commands list
+			}
 		}
 	}
 
@@ -0,0 +1,150 @@
+/**
+ * @file	watcher.hpp
+ * @author	radj307
+ * @brief	Contains the FileWatcher object, which calls a function from a background thread when files change.
+ *\n		Used by long-running modes to reload the config & hosts files without restarting.
+ */
+#pragma once
+#include "globals.h"
+
+#include <sysarch.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+#ifdef OS_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @class	FileWatcher
+ * @brief	Watches a set of files & calls a function with the path of each one that changes.
+ *\n		On Linux, the directories containing the files are watched with inotify, so files that are replaced by
+ *\n		renaming a new copy over them are detected too. On other platforms, modification times are polled.
+ *\n		Bursts of changes are combined, so the function is called once after the file has been quiet for SETTLE_TIME.
+ */
+class FileWatcher {
+	using Callback = std::function<void(const std::filesystem::path&)>;
+
+	/// @brief	Time to wait after the last change before calling the function.
+	static constexpr const std::chrono::milliseconds SETTLE_TIME{ 200 };
+	/// @brief	Maximum time between checks of the stop flag.
+	static constexpr const std::chrono::milliseconds POLL_INTERVAL{ 250 };
+
+	std::vector<std::filesystem::path> files;
+	Callback on_change;
+	std::atomic<bool> stop{ false };
+	std::thread thread;
+
+	/// @brief	Call the function for each changed file. Exceptions are printed rather than thrown, so that a bad edit can't stop the watcher.
+	void notify(std::set<size_t>& changed)
+	{
+		for (const auto& index : changed) {
+			try {
+				on_change(files[index]);
+			} catch (const std::exception& ex) {
+				std::cerr << Global.palette.get_error() << "Failed to reload " << files[index] << ": " << ex.what() << std::endl;
+			} catch (...) {
+				std::cerr << Global.palette.get_error() << "Failed to reload " << files[index] << ": An unknown exception occurred!" << std::endl;
+			}
+		}
+		changed.clear();
+	}
+
+#ifdef OS_LINUX
+	void run()
+	{
+		const int fd{ inotify_init1(IN_NONBLOCK | IN_CLOEXEC) };
+		if (fd == -1)
+			return;
+
+		// watch each directory once, & remember which files are in it
+		std::map<int, std::filesystem::path> dirs;
+		for (const auto& file : files) {
+			const auto dir{ file.parent_path().empty() ? std::filesystem::path{ "." } : file.parent_path() };
+			if (const int wd{ inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) }; wd != -1)
+				dirs.emplace(wd, dir);
+		}
+
+		std::set<size_t> changed;
+		auto last_event{ std::chrono::steady_clock::now() };
+		alignas(inotify_event) char buffer[4096];
+		while (!stop) {
+			pollfd pfd{ fd, POLLIN, 0 };
+			if (::poll(&pfd, 1, static_cast<int>((changed.empty() ? POLL_INTERVAL : SETTLE_TIME).count())) > 0) {
+				for (ssize_t len; (len = ::read(fd, buffer, sizeof(buffer))) > 0; ) {
+					for (char* p{ buffer }; p < buffer + len; ) {
+						const auto* event{ reinterpret_cast<const inotify_event*>(p) };
+						p += sizeof(inotify_event) + event->len;
+						if (event->len == 0 || !dirs.contains(event->wd))
+							continue;
+						const std::string_view name{ event->name };
+						for (size_t i{ 0ull }; i < files.size(); ++i)
+							if (files[i].filename() == name)
+								changed.insert(i);
+					}
+				}
+				last_event = std::chrono::steady_clock::now();
+			}
+			else if (!changed.empty() && std::chrono::steady_clock::now() - last_event >= SETTLE_TIME)
+				notify(changed);
+		}
+		::close(fd);
+	}
+#else
+	void run()
+	{
+		const auto get_times{ [this] {
+			std::vector<std::filesystem::file_time_type> times;
+			for (const auto& file : files) {
+				std::error_code ec;
+				times.emplace_back(std::filesystem::last_write_time(file, ec));
+			}
+			return times;
+		} };
+
+		auto times{ get_times() };
+		std::set<size_t> changed;
+		while (!stop) {
+			std::this_thread::sleep_for(POLL_INTERVAL);
+			const auto now{ get_times() };
+			for (size_t i{ 0ull }; i < files.size(); ++i)
+				if (now[i] != times[i])
+					changed.insert(i);
+			if (now == times && !changed.empty())
+				notify(changed);
+			times = now;
+		}
+	}
+#endif
+
+public:
+	/**
+	 * @brief			Start watching files.
+	 * @param files		The files to watch. They don't need to exist yet, but their directories do.
+	 * @param on_change	Called from the background thread with the path of each file that changed.
+	 */
+	FileWatcher(std::vector<std::filesystem::path> files, Callback on_change) : files{ std::move(files) }, on_change{ std::move(on_change) }
+	{
+		thread = std::thread{ &FileWatcher::run, this };
+	}
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	~FileWatcher()
+	{
+		stop = true;
+		if (thread.joinable())
+			thread.join();
+	}
+};
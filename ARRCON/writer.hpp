@@ -0,0 +1,157 @@
+/**
+ * @file	writer.hpp
+ * @author	radj307
+ * @brief	Contains the AsyncWriter object, which writes to several output files from a background thread.
+ */
+#pragma once
+#include <sysarch.h>
+#include <make_exception.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @class	AsyncWriter
+ * @brief	Buffers output for any number of files & writes it from a background thread in large batches,
+ *\n		so callers never wait for the disk.
+ *\n		Data is written once a file has buffered BATCH_SIZE bytes, when FLUSH_INTERVAL elapses, or when the writer is closed.
+ *\n		Write errors don't interrupt the caller; they're recorded for each file & returned by close().
+ */
+class AsyncWriter {
+	struct File {
+		int fd;
+		std::filesystem::path path;
+		/// @brief	Data waiting to be written. Guarded by mtx.
+		std::string pending;
+		/// @brief	Data being written by the background thread. Swapped with pending to reuse both buffers.
+		std::string writing;
+		/// @brief	The error code of the first failed write, or 0. Only accessed by the background thread until it's joined.
+		int error{ 0 };
+	};
+
+	/// @brief	Number of bytes a file can buffer before the background thread is woken.
+	static constexpr const size_t BATCH_SIZE{ 256ull * 1024ull };
+	/// @brief	Maximum amount of time that buffered data is held before being written.
+	static constexpr const std::chrono::milliseconds FLUSH_INTERVAL{ 200 };
+
+	std::vector<File> files;
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool stop{ false };
+	bool full{ false };
+	std::thread thread;
+
+	/// @brief	Background thread function.
+	void run()
+	{
+		std::unique_lock lock(mtx);
+		while (true) {
+			cv.wait_for(lock, FLUSH_INTERVAL, [this] { return stop || full; });
+			full = false;
+			for (auto& file : files)
+				file.writing.swap(file.pending);
+			const bool done{ stop };
+
+			lock.unlock();
+			for (auto& file : files) {
+				// once a file fails, the rest of its output is dropped rather than stalling the other files
+				for (size_t pos{ 0ull }; file.error == 0 && pos < file.writing.size(); ) {
+					const auto written{ ::write(file.fd, file.writing.data() + pos, static_cast<unsigned>(file.writing.size() - pos)) };
+					if (written > 0)
+						pos += static_cast<size_t>(written);
+					else if (written == -1 && errno == EINTR)
+						continue;
+					else file.error = written == -1 ? errno : EIO;
+				}
+				file.writing.clear();
+			}
+			lock.lock();
+
+			if (done)
+				break;
+		}
+	}
+
+public:
+	AsyncWriter() = default;
+	AsyncWriter(const AsyncWriter&) = delete;
+	AsyncWriter& operator=(const AsyncWriter&) = delete;
+	~AsyncWriter() { close(); }
+
+	/**
+	 * @brief			Open (or truncate) an output file. All files must be opened before start() is called.
+	 * @param path		Location of the file.
+	 * @throws except	The file couldn't be opened.
+	 * @returns			size_t	The file's ID, which is passed to write().
+	 */
+	size_t open(const std::filesystem::path& path)
+	{
+		const int fd{ ::open(path.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+		if (fd == -1)
+			throw make_exception("Failed to open output file ", path, " for writing!");
+		files.emplace_back(File{ fd, path, {}, {}, 0 });
+		return files.size() - 1ull;
+	}
+
+	/// @brief	Start the background thread.
+	void start()
+	{
+		if (!thread.joinable())
+			thread = std::thread{ &AsyncWriter::run, this };
+	}
+
+	/**
+	 * @brief		Queue data to be written to a file. This never blocks on I/O.
+	 * @param id	The file's ID, from open().
+	 * @param data	The data to append to the file.
+	 */
+	void write(const size_t& id, const std::string_view& data)
+	{
+		std::scoped_lock lock(mtx);
+		auto& pending{ files[id].pending };
+		pending += data;
+		if (pending.size() >= BATCH_SIZE && !full) {
+			full = true;
+			cv.notify_one();
+		}
+	}
+
+	/**
+	 * @brief	Write all buffered data, stop the background thread, & close every file.
+	 * @returns	std::vector<std::string>	A message for each file that couldn't be written completely.
+	 */
+	std::vector<std::string> close()
+	{
+		if (!files.empty()) {
+			start(); // the background thread writes anything that was buffered before it started
+			{
+				std::scoped_lock lock(mtx);
+				stop = true;
+			}
+			cv.notify_one();
+			thread.join();
+		}
+		std::vector<std::string> errors;
+		for (auto& file : files) {
+			if (file.fd != -1) {
+				if (::close(file.fd) == -1 && file.error == 0)
+					file.error = errno;
+				file.fd = -1;
+			}
+			if (file.error != 0)
+				errors.emplace_back("Failed to write output file " + file.path.string() + ": " + std::strerror(file.error));
+		}
+		files.clear();
+		return errors;
+	}
+};